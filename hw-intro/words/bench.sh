@@ -0,0 +1,65 @@
+#!/bin/sh
+#
+# Benchmarks words-list and words-hash (built by `make bench`) on words.txt
+# and on generated input, reading it both memory-mapped and with read().
+#
+# Settings come from the environment:
+#   BENCH_SIZES     generated input sizes, with K/M/G suffixes (default "1G")
+#   BENCH_VOCAB     distinct words in the generated input      (default 20000)
+#   BENCH_LIST_MAX  largest input words-list runs on, since it takes time
+#                   proportional to the vocabulary per word    (default 16M)
+#   BENCH_DIR       where inputs are generated and kept        (default bench-data)
+#
+# The input is generated by gen_corpus, so word frequencies follow a Zipf
+# distribution over a fixed vocabulary that does not grow with the size.
+
+set -e
+
+SIZES=${BENCH_SIZES:-1G}
+VOCAB=${BENCH_VOCAB:-20000}
+LIST_MAX=$(numfmt --from=iec "${BENCH_LIST_MAX:-16M}")
+DIR=${BENCH_DIR:-bench-data}
+
+# generate BYTES FILE
+generate() {
+  mkdir -p "$DIR"
+  ./gen_corpus -v "$VOCAB" "$1" > "$2.tmp"
+  mv "$2.tmp" "$2"
+}
+
+# run INPUT BYTES PROGRAM [--stdio]
+run() {
+  mode=mmap
+  if [ -n "$4" ]; then
+    mode=read
+  fi
+  start=$(date +%s.%N)
+  "./$3" -f $4 "$1" > /dev/null
+  end=$(date +%s.%N)
+  awk -v input="$1" -v bytes="$2" -v name="$3" -v mode="$mode" \
+      -v start="$start" -v end="$end" 'BEGIN {
+    s = end - start
+    printf "%-24s %-12s %-8s %9.3f %9.1f\n", input, name, mode, s, (s > 0 ? bytes / 1048576 / s : 0)
+  }'
+}
+
+printf "%-24s %-12s %-8s %9s %9s\n" input program read seconds MB/s
+
+inputs=words.txt
+for size in $SIZES; do
+  if [ ! -f "$DIR/$size.txt" ]; then
+    generate "$(numfmt --from=iec "$size")" "$DIR/$size.txt"
+  fi
+  inputs="$inputs $DIR/$size.txt"
+done
+
+for input in $inputs; do
+  bytes=$(wc -c < "$input")
+  for program in words-list words-hash; do
+    if [ "$program" = words-list ] && [ "$bytes" -gt "$LIST_MAX" ]; then
+      continue
+    fi
+    run "$input" "$bytes" "$program"
+    run "$input" "$bytes" "$program" --stdio
+  done
+done
@@ -23,20 +23,115 @@ OF THIS SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
 
 #include <assert.h>
 #include <ctype.h>
+#include <errno.h>
 #include <getopt.h>
 #include <stdbool.h>
 #include <stddef.h>
 #include <stdio.h>
 #include <stdlib.h>
 #include <string.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <unistd.h>
 
 #include "word_count.h"
+#include "word_tokenizer.h"
 
 /* Global data structure tracking the words encountered */
 WordCount *word_counts = NULL;
 
-/* The maximum length of each word in a file */
-#define MAX_WORD_LEN 64
+/* Size of the chunks input that cannot be mapped is read in */
+#define READ_CHUNK (64 * 1024)
+
+/* Cleared by --stdio to always read input with read() */
+static bool use_mmap = true;
+
+/*
+ * Maps infile into memory, storing its size in len. Returns NULL if infile is
+ * not a non-empty regular file, in which case it has to be read with
+ * read_words().
+ */
+static char *map_file(FILE *infile, size_t *len) {
+  struct stat st;
+  int fd = fileno(infile);
+
+  if (!use_mmap || fstat(fd, &st) != 0 || !S_ISREG(st.st_mode) || st.st_size == 0) {
+    return NULL;
+  }
+
+  char *map = mmap(NULL, st.st_size, PROT_READ, MAP_PRIVATE, fd, 0);
+  if (map == MAP_FAILED) {
+    return NULL;
+  }
+
+  madvise(map, st.st_size, MADV_SEQUENTIAL);
+  *len = st.st_size;
+  return map;
+}
+
+/*
+ * Reads infile to the end in chunks and calls emit for every word in it. Each
+ * chunk is cut after its last non-letter and the partial word behind the cut
+ * is carried over into the next chunk, which grows if a single word fills it.
+ */
+static void read_words(FILE *infile, word_emit_func *emit, void *aux) {
+  int fd = fileno(infile);
+  size_t cap = READ_CHUNK, len = 0;
+  char *buf = malloc(cap);
+
+  if (buf == NULL) {
+    perror("malloc");
+    return;
+  }
+
+  for (;;) {
+    if (len == cap) {
+      char *bigger = realloc(buf, 2 * cap);
+      if (bigger == NULL) {
+        perror("realloc");
+        break;
+      }
+      buf = bigger;
+      cap *= 2;
+    }
+
+    ssize_t n = read(fd, buf + len, cap - len);
+    if (n < 0 && errno == EINTR) {
+      continue;
+    }
+    if (n < 0) {
+      perror("read");
+      break;
+    }
+    if (n == 0) {
+      break;
+    }
+
+    len += n;
+    size_t cut = len;
+    while (cut > 0 && isalpha((unsigned char)buf[cut - 1])) {
+      cut--;
+    }
+    if (cut == 0) {
+      continue;
+    }
+
+    tokenize_words(buf, cut, emit, aux);
+    memmove(buf, buf + cut, len - cut);
+    len -= cut;
+  }
+
+  tokenize_words(buf, len, emit, aux);
+  free(buf);
+}
+
+static void count_word(const char *word, size_t len, void *aux) {
+  *(int *)aux += 1;
+}
+
+static void add_word_slice(const char *word, size_t len, void *aux) {
+  add_word_n((WordCount **)aux, word, len);
+}
 
 /*
  * 3.1.1 Total Word Count
@@ -45,17 +140,15 @@ WordCount *word_counts = NULL;
  * Useful functions: fgetc(), isalpha().
  */
 int num_words(FILE *infile) {
-  int c, in_word = 0, num_words = 0;
+  int num_words = 0;
+  size_t len;
+  char *map = map_file(infile, &len);
 
-  while ((c = fgetc(infile)) != EOF) {
-    if (isalpha(c)) {
-      in_word = 1;
-    } else {
-      if (in_word) {
-        num_words += 1;
-        in_word = 0;
-      }
-    }
+  if (map != NULL) {
+    tokenize_words(map, len, count_word, &num_words);
+    munmap(map, len);
+  } else {
+    read_words(infile, count_word, &num_words);
   }
 
   return num_words;
@@ -68,26 +161,14 @@ int num_words(FILE *infile) {
  * Useful functions: fgetc(), isalpha(), tolower(), add_word().
  */
 void count_words(WordCount **wclist, FILE *infile) {
-  int c, in_word = 0, index = 0;
-  char buffer[MAX_WORD_LEN];
-
-  while ((c = fgetc(infile)) != EOF) {
-    if (isalpha(c)) {
-      if (in_word) {
-        buffer[index] = tolower(c);
-        index += 1;
-      } else {
-        buffer[0] = tolower(c);
-        index = 1;
-        in_word = 1;
-      }
-    } else {
-      if (in_word) {
-        buffer[index] = '\0';
-        add_word(wclist, buffer);
-        in_word = 0;
-      }
-    }
+  size_t len;
+  char *map = map_file(infile, &len);
+
+  if (map != NULL) {
+    tokenize_words(map, len, add_word_slice, wclist);
+    munmap(map, len);
+  } else {
+    read_words(infile, add_word_slice, wclist);
   }
 }
 
@@ -112,6 +193,10 @@ static int display_help(void) {
       "specified.\n"
       "--frequency (-f): Count the frequency of each word in the file, or "
       "STDIN if a file is not specified.\n"
+      "--top (-k) N: Like --frequency, but only print the N most frequent "
+      "words.\n"
+      "--stdio (-s): Read the input in chunks with read() instead of "
+      "memory-mapping it.\n"
       "--help (-h): Displays this help message.\n");
   return 0;
 }
@@ -127,17 +212,22 @@ int main(int argc, char *argv[]) {
   // Freq Mode: outputs the frequency of each word
   bool freq_mode = false;
 
+  // Top Mode: outputs only the top_words most frequent words
+  long top_words = 0;
+
   FILE *infile = NULL;
 
   // Variables for command line argument parsing
   int i;
   static struct option long_options[] = {{"count", no_argument, 0, 'c'},
                                          {"frequency", no_argument, 0, 'f'},
+                                         {"top", required_argument, 0, 'k'},
+                                         {"stdio", no_argument, 0, 's'},
                                          {"help", no_argument, 0, 'h'},
                                          {0, 0, 0, 0}};
 
   // Sets flags
-  while ((i = getopt_long(argc, argv, "cfh", long_options, NULL)) != -1) {
+  while ((i = getopt_long(argc, argv, "cfk:sh", long_options, NULL)) != -1) {
     switch (i) {
       case 'c':
         count_mode = true;
@@ -147,6 +237,14 @@ int main(int argc, char *argv[]) {
         count_mode = false;
         freq_mode = true;
         break;
+      case 'k':
+        count_mode = false;
+        freq_mode = true;
+        top_words = atol(optarg);
+        break;
+      case 's':
+        use_mmap = false;
+        break;
       case 'h':
         return display_help();
     }
@@ -175,7 +273,14 @@ int main(int argc, char *argv[]) {
     printf("The total number of words is: %i\n", total_words);
   } else {
     count_words(&word_counts, infile);
-    wordcount_sort(&word_counts, wordcount_less);
+    if (top_words > 0) {
+      if (wordcount_top(&word_counts, top_words, wordcount_less) != 0) {
+        perror("wordcount_top");
+        return 1;
+      }
+    } else {
+      wordcount_sort(&word_counts, wordcount_less);
+    }
 
     printf("The frequencies of each word are: \n");
     fprint_words(word_counts, stdout);
@@ -28,23 +28,21 @@ char *new_string(char *str) {
   return strcpy((char *)malloc(strlen(str) + 1), str);
 }
 
+#ifndef HASH_TABLE
+/* The list representation; word_count_h.c replaces these with a hash index. */
+
+static char *new_string_n(const char *str, size_t len) {
+  char *s = malloc(len + 1);
+  memcpy(s, str, len);
+  s[len] = '\0';
+  return s;
+}
+
 void init_words(WordCount **wclist) {
   /* Initialize word count.  */
   *wclist = NULL;
 }
 
-size_t len_words(WordCount *wchead) {
-  size_t len = 0;
-  WordCount *wc = wchead;
-
-  while (wc != NULL) {
-    len += 1;
-    wc = wc->next;
-  }
-
-  return len;
-}
-
 WordCount *find_word(WordCount *wchead, char *word) {
   WordCount *wc = wchead;
 
@@ -58,40 +56,46 @@ WordCount *find_word(WordCount *wchead, char *word) {
   return wc;
 }
 
-void add_word(WordCount **wclist, char *word) {
+void add_word_n(WordCount **wclist, const char *word, size_t len) {
   /* If word is present in word_counts list, increment the count, otw insert
    * with count 1. */
   WordCount *wc = *wclist;
+  WordCount *last = NULL;
 
-  if (wc == NULL) {
-    wc = malloc(sizeof(WordCount));
-    wc->count = 1;
-    wc->word = new_string(word);
-    wc->next = NULL;
-
-    *wclist = wc;
-
-    return;
+  for (; wc != NULL; last = wc, wc = wc->next) {
+    if (strncmp(wc->word, word, len) == 0 && wc->word[len] == '\0') {
+      wc->count += 1;
+      return;
+    }
   }
 
-  wc = find_word(*wclist, word);
-  if (wc != NULL) {
-    wc->count += 1;
+  wc = (WordCount *)malloc(sizeof(WordCount));
+  wc->count = 1;
+  wc->word = new_string_n(word, len);
+  wc->next = NULL;
 
-    return;
+  if (last == NULL) {
+    *wclist = wc;
+  } else {
+    last->next = wc;
   }
+}
+#endif /* HASH_TABLE */
 
-  wc = *wclist;
-  while (wc->next != NULL) {
+size_t len_words(WordCount *wchead) {
+  size_t len = 0;
+  WordCount *wc = wchead;
+
+  while (wc != NULL) {
+    len += 1;
     wc = wc->next;
   }
 
-  wc->next = (WordCount *)malloc(sizeof(WordCount));
-  wc->next->count = 1;
-  wc->next->word = new_string(word);
-  wc->next->next = NULL;
+  return len;
+}
 
-  return;
+void add_word(WordCount **wclist, char *word) {
+  add_word_n(wclist, word, strlen(word));
 }
 
 void fprint_words(WordCount *wchead, FILE *ofile) {
@@ -101,3 +105,86 @@ void fprint_words(WordCount *wchead, FILE *ofile) {
     fprintf(ofile, "%i\t%s\n", wc->count, wc->word);
   }
 }
+
+static void heap_sift_down(WordCount **heap, size_t i, size_t len,
+                           bool less(const WordCount *, const WordCount *)) {
+  for (;;) {
+    size_t min = i, l = 2 * i + 1, r = 2 * i + 2;
+    if (l < len && less(heap[l], heap[min]))
+      min = l;
+    if (r < len && less(heap[r], heap[min]))
+      min = r;
+    if (min == i)
+      return;
+
+    WordCount *tmp = heap[i];
+    heap[i] = heap[min];
+    heap[min] = tmp;
+    i = min;
+  }
+}
+
+static void free_word(WordCount *wc) {
+  free(wc->word);
+  free(wc);
+}
+
+int wordcount_top(WordCount **wclist, size_t k, bool less(const WordCount *, const WordCount *)) {
+  size_t n = len_words(*wclist);
+  if (k > n) {
+    k = n;
+  }
+
+  /* min-heap of the k greatest elements seen so far, smallest at the root */
+  WordCount **heap = malloc((k > 0 ? k : 1) * sizeof(WordCount *));
+  if (heap == NULL) {
+    return -1;
+  }
+
+  size_t len = 0;
+  WordCount *wc = *wclist;
+
+  while (wc != NULL) {
+    WordCount *next = wc->next;
+
+    if (len < k) {
+      size_t i = len++;
+      heap[i] = wc;
+      while (i > 0 && less(heap[i], heap[(i - 1) / 2])) {
+        WordCount *tmp = heap[i];
+        heap[i] = heap[(i - 1) / 2];
+        heap[(i - 1) / 2] = tmp;
+        i = (i - 1) / 2;
+      }
+    } else if (k > 0 && less(heap[0], wc)) {
+      free_word(heap[0]);
+      heap[0] = wc;
+      heap_sift_down(heap, 0, len, less);
+    } else {
+      free_word(wc);
+    }
+
+    wc = next;
+  }
+
+  /* popping the minimum repeatedly yields the list in ascending order;
+     build it back to front */
+  *wclist = NULL;
+  WordCount **tail = wclist;
+  while (len > 0) {
+    WordCount *min = heap[0];
+    heap[0] = heap[--len];
+    heap_sift_down(heap, 0, len, less);
+
+    min->next = NULL;
+    *tail = min;
+    tail = &min->next;
+  }
+
+  free(heap);
+
+#ifdef HASH_TABLE
+  reindex_words(wclist);
+#endif
+  return 0;
+}
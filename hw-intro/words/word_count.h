@@ -41,6 +41,13 @@ struct word_count {
     char *word;
     int count;
     struct word_count *next;
+#ifdef HASH_TABLE
+    /* Hash index of the list the word is on, the next word in the same hash
+       bucket, and the word's hash, see word_count_h.c */
+    struct word_index *index;
+    struct word_count *chain;
+    size_t hash;
+#endif
 };
 
 /* Introduce a type name for the struct */
@@ -58,6 +65,9 @@ WordCount *find_word(WordCount *wchead, char *word);
 /* Insert word with count=1, if not already present; increment count if present. */
 void add_word(WordCount **wclist, char *word);
 
+/* add_word for the len bytes at word, which need not be NUL-terminated. */
+void add_word_n(WordCount **wclist, const char *word, size_t len);
+
 //static int wordcntcmp(const WordCount *wc1, WordCount *wc2);
 
 /* print word counts to a file */
@@ -69,6 +79,16 @@ void wordcount_insert_ordered(WordCount **wclist, WordCount *elem, bool less(con
 /* Sort a word count list in place */
 void wordcount_sort(WordCount **wclist, bool less(const WordCount *, const WordCount *));
 
+/* Reduce a word count list to its k greatest elements, sorted as by wordcount_sort.
+   Uses a bounded min-heap instead of sorting the whole list; the rest is freed.
+   Returns -1, leaving the list as it was, if the heap cannot be allocated. */
+int wordcount_top(WordCount **wclist, size_t k, bool less(const WordCount *, const WordCount *));
+
+#ifdef HASH_TABLE
+/* Rebuilds the hash index of a list after nodes were removed from it. */
+void reindex_words(WordCount **wclist);
+#endif
+
 #endif /* word_count_h */
 
 
@@ -0,0 +1,174 @@
+/*
+
+Copyright © 2019 University of California, Berkeley
+
+THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS
+"AS IS" AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT
+LIMITED TO, THE IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR
+A PARTICULAR PURPOSE ARE DISCLAIMED. IN NO EVENT SHALL THE COPYRIGHT
+HOLDER OR CONTRIBUTORS BE LIABLE FOR ANY DIRECT, INDIRECT, INCIDENTAL,
+SPECIAL, EXEMPLARY, OR CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT
+LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES; LOSS OF USE,
+DATA, OR PROFITS; OR BUSINESS INTERRUPTION) HOWEVER CAUSED AND ON ANY
+THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY, OR TORT
+(INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE
+OF THIS SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+
+Hash indexed word counts, selected with `make HASH_TABLE=1`.
+
+The words are still kept in a singly linked list, so wordcount_sort and
+fprint_words work on them unchanged, but each list also gets a chained hash
+index over its nodes so add_word_n and find_word take expected constant time
+instead of scanning the list. Every node points at the index of its list, so
+the index is found from whichever node is at the head, also after the list
+was reordered by a sort.
+*/
+
+#ifndef HASH_TABLE
+#error "HASH_TABLE must be #define'd when compiling word_count_h.c"
+#endif
+
+#include "word_count.h"
+
+#define INITIAL_BUCKETS 1024
+
+struct word_index {
+  WordCount **buckets;  /* chains through WordCount.chain */
+  size_t num_buckets;   /* power of two */
+  size_t num_words;
+  WordCount *tail;      /* a node at or before the end of the list */
+};
+
+static size_t hash_word(const char *word, size_t len) {
+  size_t h = 14695981039346656037ull;
+
+  for (size_t i = 0; i < len; i++) {
+    h ^= (unsigned char)word[i];
+    h *= 1099511628211ull;
+  }
+
+  return h;
+}
+
+static char *new_string_n(const char *str, size_t len) {
+  char *s = malloc(len + 1);
+  memcpy(s, str, len);
+  s[len] = '\0';
+  return s;
+}
+
+static void index_insert(struct word_index *idx, WordCount *wc) {
+  size_t b = wc->hash & (idx->num_buckets - 1);
+  wc->chain = idx->buckets[b];
+  idx->buckets[b] = wc;
+  idx->num_words++;
+}
+
+static struct word_index *new_index(void) {
+  struct word_index *idx = malloc(sizeof(struct word_index));
+
+  idx->num_buckets = INITIAL_BUCKETS;
+  idx->buckets = calloc(idx->num_buckets, sizeof(WordCount *));
+  idx->num_words = 0;
+  idx->tail = NULL;
+  return idx;
+}
+
+/* Doubles the bucket array once the chains average more than one word. */
+static void grow_index(struct word_index *idx) {
+  size_t old_buckets = idx->num_buckets;
+  WordCount **old = idx->buckets;
+
+  idx->num_buckets *= 2;
+  idx->buckets = calloc(idx->num_buckets, sizeof(WordCount *));
+  idx->num_words = 0;
+
+  for (size_t b = 0; b < old_buckets; b++) {
+    WordCount *wc = old[b];
+    while (wc != NULL) {
+      WordCount *chain = wc->chain;
+      index_insert(idx, wc);
+      wc = chain;
+    }
+  }
+
+  free(old);
+}
+
+static WordCount *index_find(struct word_index *idx, const char *word, size_t len, size_t hash) {
+  WordCount *wc = idx->buckets[hash & (idx->num_buckets - 1)];
+
+  for (; wc != NULL; wc = wc->chain) {
+    if (wc->hash == hash && strncmp(wc->word, word, len) == 0 && wc->word[len] == '\0') {
+      return wc;
+    }
+  }
+
+  return NULL;
+}
+
+void init_words(WordCount **wclist) {
+  /* Initialize word count. The index is created along with the first node. */
+  *wclist = NULL;
+}
+
+WordCount *find_word(WordCount *wchead, char *word) {
+  if (wchead == NULL) {
+    return NULL;
+  }
+
+  size_t len = strlen(word);
+  return index_find(wchead->index, word, len, hash_word(word, len));
+}
+
+void add_word_n(WordCount **wclist, const char *word, size_t len) {
+  struct word_index *idx = *wclist != NULL ? (*wclist)->index : new_index();
+  size_t hash = hash_word(word, len);
+  WordCount *wc = index_find(idx, word, len, hash);
+
+  if (wc != NULL) {
+    wc->count += 1;
+    return;
+  }
+
+  wc = (WordCount *)malloc(sizeof(WordCount));
+  wc->count = 1;
+  wc->word = new_string_n(word, len);
+  wc->next = NULL;
+  wc->index = idx;
+  wc->hash = hash;
+  wc->chain = NULL;
+
+  /* Appends, like the list version. A sort may have moved the old tail
+     away from the end, in which case it is walked forward once. */
+  WordCount *tail = idx->tail;
+  if (*wclist == NULL) {
+    *wclist = wc;
+  } else {
+    while (tail->next != NULL) {
+      tail = tail->next;
+    }
+    tail->next = wc;
+  }
+
+  idx->tail = wc;
+  index_insert(idx, wc);
+  if (idx->num_words > idx->num_buckets) {
+    grow_index(idx);
+  }
+}
+
+void reindex_words(WordCount **wclist) {
+  if (*wclist == NULL) {
+    return;
+  }
+
+  struct word_index *idx = (*wclist)->index;
+  memset(idx->buckets, 0, idx->num_buckets * sizeof(WordCount *));
+  idx->num_words = 0;
+
+  for (WordCount *wc = *wclist; wc != NULL; wc = wc->next) {
+    index_insert(idx, wc);
+    idx->tail = wc;
+  }
+}
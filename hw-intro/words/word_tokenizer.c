@@ -0,0 +1,151 @@
+/*
+
+Tokenizer that splits a buffer into runs of letters, folding them to lower
+case 64 bytes at a time with SSE2 (or AVX2 when built with -mavx2).
+
+*/
+
+#include <stdint.h>
+#include <stdlib.h>
+
+#if defined(__AVX2__)
+#include <immintrin.h>
+#elif defined(__SSE2__)
+#include <emmintrin.h>
+#endif
+
+#include "word_tokenizer.h"
+
+/*
+ * Input is processed in regions of about REGION_SIZE bytes that end outside
+ * of a word, so the folded copy of a region stays in cache while its words
+ * are counted.
+ */
+#define REGION_SIZE (64 * 1024)
+
+static bool is_letter(char c) { return (unsigned)(((unsigned char)c | 0x20) - 'a') < 26; }
+
+/*
+ * Folds the 64 bytes at IN to lower case into OUT and returns a mask with bit
+ * i set if IN[i] is a letter.
+ */
+static uint64_t fold64(const char *in, char *out) {
+#if defined(__AVX2__)
+  const __m256i case_bit = _mm256_set1_epi8(0x20);
+  const __m256i before_a = _mm256_set1_epi8('a' - 1);
+  const __m256i after_z = _mm256_set1_epi8('z' + 1);
+  uint64_t mask = 0;
+
+  for (int i = 0; i < 64; i += 32) {
+    __m256i c = _mm256_loadu_si256((const __m256i *)(in + i));
+    __m256i lower = _mm256_or_si256(c, case_bit);
+    __m256i alpha = _mm256_and_si256(_mm256_cmpgt_epi8(lower, before_a),
+                                     _mm256_cmpgt_epi8(after_z, lower));
+    c = _mm256_or_si256(c, _mm256_and_si256(alpha, case_bit));
+    _mm256_storeu_si256((__m256i *)(out + i), c);
+    mask |= (uint64_t)(uint32_t)_mm256_movemask_epi8(alpha) << i;
+  }
+
+  return mask;
+#elif defined(__SSE2__)
+  const __m128i case_bit = _mm_set1_epi8(0x20);
+  const __m128i before_a = _mm_set1_epi8('a' - 1);
+  const __m128i after_z = _mm_set1_epi8('z' + 1);
+  uint64_t mask = 0;
+
+  for (int i = 0; i < 64; i += 16) {
+    __m128i c = _mm_loadu_si128((const __m128i *)(in + i));
+    __m128i lower = _mm_or_si128(c, case_bit);
+    /* signed compares: bytes >= 0x80 are negative and never letters */
+    __m128i alpha = _mm_and_si128(_mm_cmpgt_epi8(lower, before_a), _mm_cmplt_epi8(lower, after_z));
+    c = _mm_or_si128(c, _mm_and_si128(alpha, case_bit));
+    _mm_storeu_si128((__m128i *)(out + i), c);
+    mask |= (uint64_t)(uint16_t)_mm_movemask_epi8(alpha) << i;
+  }
+
+  return mask;
+#else
+  uint64_t mask = 0;
+
+  for (int i = 0; i < 64; i++) {
+    bool alpha = is_letter(in[i]);
+    out[i] = alpha ? in[i] | 0x20 : in[i];
+    mask |= (uint64_t)alpha << i;
+  }
+
+  return mask;
+#endif
+}
+
+/* Scalar fold64 for the last N < 64 bytes of a region. */
+static uint64_t fold_tail(const char *in, char *out, size_t n) {
+  uint64_t mask = 0;
+
+  for (size_t i = 0; i < n; i++) {
+    bool alpha = is_letter(in[i]);
+    out[i] = alpha ? in[i] | 0x20 : in[i];
+    mask |= (uint64_t)alpha << i;
+  }
+
+  return mask;
+}
+
+/*
+ * Tokenizes the N bytes at IN, which end outside of a word, using SCRATCH for
+ * the folded copy. Word starts and ends are found from the letter masks, so
+ * the loop runs once per word rather than once per byte.
+ */
+static void tokenize_region(const char *in, size_t n, char *scratch, word_emit_func *emit,
+                            void *aux) {
+  uint64_t in_word = 0;
+  size_t start = 0;
+
+  for (size_t base = 0; base < n; base += 64) {
+    uint64_t mask = n - base >= 64 ? fold64(in + base, scratch + base)
+                                   : fold_tail(in + base, scratch + base, n - base);
+    uint64_t shifted = (mask << 1) | in_word;
+    uint64_t starts = mask & ~shifted;
+    uint64_t events = starts | (~mask & shifted);
+
+    while (events) {
+      int bit = __builtin_ctzll(events);
+      if (starts & ((uint64_t)1 << bit)) {
+        start = base + bit;
+      } else {
+        emit(scratch + start, base + bit - start, aux);
+      }
+      events &= events - 1;
+    }
+
+    in_word = mask >> 63;
+  }
+
+  if (in_word)
+    emit(scratch + start, n - start, aux);
+}
+
+void tokenize_words(const char *buf, size_t len, word_emit_func *emit, void *aux) {
+  size_t cap = REGION_SIZE;
+  char *scratch = malloc(cap);
+  size_t pos = 0;
+
+  while (pos < len) {
+    size_t end = pos + REGION_SIZE;
+    if (end >= len) {
+      end = len;
+    } else {
+      while (end < len && is_letter(buf[end]))
+        end++;
+    }
+
+    if (end - pos > cap) {
+      cap = end - pos;
+      scratch = realloc(scratch, cap);
+    }
+
+    tokenize_region(buf + pos, end - pos, scratch, emit, aux);
+    pos = end;
+  }
+
+  free(scratch);
+}
@@ -0,0 +1,22 @@
+/*
+
+word_tokenizer splits a buffer into words: runs of letters, folded to lower
+case. Words are passed on as slices of a scratch buffer rather than copied
+into a fixed-size word buffer.
+
+*/
+
+#ifndef word_tokenizer_h
+#define word_tokenizer_h
+
+#include <stdbool.h>
+#include <stddef.h>
+
+/* Receives a word, folded to lower case and not NUL-terminated. */
+typedef void word_emit_func(const char *word, size_t len, void *aux);
+
+/* Calls emit for every word in the len bytes at buf. The slice is only valid
+   during the call. */
+void tokenize_words(const char *buf, size_t len, word_emit_func *emit, void *aux);
+
+#endif /* word_tokenizer_h */
@@ -0,0 +1,80 @@
+#!/bin/sh
+#
+# Benchmarks the word counters on generated Zipfian corpora, see `make bench`.
+#
+# Settings come from the environment:
+#   BENCH_SIZES     corpus sizes, with K/M/G suffixes   (default "256K 16M 256M")
+#   BENCH_THREADS   thread counts for pwords            (default "1 2 4 8")
+#   BENCH_FILES     number of files per corpus          (default 8)
+#   BENCH_LIST_MAX  largest corpus the list based counters run on, since they
+#                   take time proportional to the vocabulary per word
+#                   (default 256K); larger corpora are not even generated
+#                   unless something runs on them
+#   BENCH_HASH_TABLE set if lwords and pwords were built with HASH_TABLE=1,
+#                   which lifts that limit for them (words is always a list)
+#   BENCH_DIR       where corpora are generated and kept (default bench-data)
+#
+# For each run it prints the throughput, the peak RSS and, for pwords, the
+# scaling efficiency: time on one thread / (threads * time on THREADS).
+
+set -e
+
+SIZES=${BENCH_SIZES:-"256K 16M 256M"}
+THREADS=${BENCH_THREADS:-"1 2 4 8"}
+FILES=${BENCH_FILES:-8}
+LIST_MAX=$(numfmt --from=iec "${BENCH_LIST_MAX:-256K}")
+DIR=${BENCH_DIR:-bench-data}
+
+# run SIZE BYTES PROGRAM THREADS BASE COMMAND...
+# Prints one result line and sets SECONDS_TAKEN. BASE is the single thread
+# time to scale against, 0 if this is the first run and -1 for no scaling.
+run() {
+  r_size=$1 r_bytes=$2 r_name=$3 r_threads=$4 r_base=$5
+  shift 5
+  set -- $(./bench_run "$@")
+  SECONDS_TAKEN=$1
+  awk -v size="$r_size" -v bytes="$r_bytes" -v name="$r_name" -v t="$r_threads" \
+      -v s="$1" -v rss="$2" -v base="$r_base" 'BEGIN {
+    eff = base > 0 ? sprintf("%.2f", base / (t * s)) : base == 0 ? "1.00" : "-"
+    printf "%-6s %-12s %7s %9.2f %9.2f %9.1f %6s\n",
+           size, name, t, s, bytes / 1048576 / s, rss / 1024, eff
+  }'
+}
+
+printf "%-6s %-12s %7s %9s %9s %9s %6s\n" size program threads seconds MB/s rss_MB eff
+
+for size in $SIZES; do
+  bytes=$(numfmt --from=iec "$size")
+  corpus=$DIR/$size
+
+  if [ -z "$BENCH_HASH_TABLE" ] && [ "$bytes" -gt "$LIST_MAX" ]; then
+    continue
+  fi
+
+  if [ ! -d "$corpus" ]; then
+    mkdir -p "$corpus.tmp"
+    for i in $(seq 1 "$FILES"); do
+      ./gen_corpus -r "$i" $((bytes / FILES)) > "$corpus.tmp/part$i.txt"
+    done
+    mv "$corpus.tmp" "$corpus"
+  fi
+
+  if [ "$bytes" -le "$LIST_MAX" ]; then
+    run "$size" "$bytes" words 1 -1 ./words "$corpus"/*.txt
+  fi
+  run "$size" "$bytes" lwords 1 -1 ./lwords "$corpus"/*.txt
+
+  for mode in files chunks; do
+    flags=
+    if [ "$mode" = chunks ]; then
+      flags=-c
+    fi
+    base=0
+    for t in $THREADS; do
+      run "$size" "$bytes" "pwords $flags" "$t" "$base" ./pwords -j "$t" $flags "$corpus"
+      if [ "$base" = 0 ]; then
+        base=$(awk -v s="$SECONDS_TAKEN" -v t="$t" 'BEGIN { print s * t }')
+      fi
+    done
+  done
+done
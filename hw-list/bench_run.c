@@ -0,0 +1,50 @@
+/*
+ * Runs a command with its output discarded and prints its wall clock time in
+ * seconds and its peak resident set size in KiB, as reported by wait4.
+ *
+ * usage: bench_run command [argument...]
+ */
+
+#include <fcntl.h>
+#include <stdio.h>
+#include <sys/resource.h>
+#include <sys/wait.h>
+#include <time.h>
+#include <unistd.h>
+
+int main(int argc, char* argv[]) {
+  struct timespec start, end;
+  struct rusage usage;
+  int status;
+
+  if (argc < 2) {
+    fprintf(stderr, "usage: %s command [argument...]\n", argv[0]);
+    return 1;
+  }
+
+  clock_gettime(CLOCK_MONOTONIC, &start);
+
+  pid_t pid = fork();
+  if (pid == 0) {
+    int null = open("/dev/null", O_WRONLY);
+    dup2(null, STDOUT_FILENO);
+    close(null);
+    execvp(argv[1], argv + 1);
+    perror(argv[1]);
+    _exit(127);
+  }
+  if (pid < 0) {
+    perror("fork");
+    return 1;
+  }
+
+  if (wait4(pid, &status, 0, &usage) < 0) {
+    perror("wait4");
+    return 1;
+  }
+  clock_gettime(CLOCK_MONOTONIC, &end);
+
+  double seconds = (end.tv_sec - start.tv_sec) + (end.tv_nsec - start.tv_nsec) / 1e9;
+  printf("%.3f %ld\n", seconds, usage.ru_maxrss);
+  return WIFEXITED(status) ? WEXITSTATUS(status) : 1;
+}
@@ -0,0 +1,61 @@
+#include <stdlib.h>
+
+#include "bq.h"
+
+/* Initializes an empty queue BQ that holds at most CAP items. */
+void bq_init(bq_t* bq, int cap) {
+  pthread_mutex_init(&bq->mutex, NULL);
+  pthread_cond_init(&bq->not_empty, NULL);
+  pthread_cond_init(&bq->not_full, NULL);
+  bq->items = malloc(cap * sizeof(void*));
+  bq->head = 0;
+  bq->size = 0;
+  bq->cap = cap;
+  bq->closed = false;
+}
+
+/* Frees BQ, but not the items still in it. */
+void bq_destroy(bq_t* bq) {
+  pthread_mutex_destroy(&bq->mutex);
+  pthread_cond_destroy(&bq->not_empty);
+  pthread_cond_destroy(&bq->not_full);
+  free(bq->items);
+}
+
+/* Adds ITEM at the back of BQ, waiting until there is room for it. */
+void bq_push(bq_t* bq, void* item) {
+  pthread_mutex_lock(&bq->mutex);
+  while (bq->size == bq->cap)
+    pthread_cond_wait(&bq->not_full, &bq->mutex);
+  bq->items[(bq->head + bq->size) % bq->cap] = item;
+  bq->size++;
+  pthread_cond_signal(&bq->not_empty);
+  pthread_mutex_unlock(&bq->mutex);
+}
+
+/* Removes the front item of BQ, waiting until there is one. Returns NULL once
+ * BQ is closed and empty. */
+void* bq_pop(bq_t* bq) {
+  void* item = NULL;
+
+  pthread_mutex_lock(&bq->mutex);
+  while (bq->size == 0 && !bq->closed)
+    pthread_cond_wait(&bq->not_empty, &bq->mutex);
+  if (bq->size > 0) {
+    item = bq->items[bq->head];
+    bq->head = (bq->head + 1) % bq->cap;
+    bq->size--;
+    pthread_cond_signal(&bq->not_full);
+  }
+  pthread_mutex_unlock(&bq->mutex);
+
+  return item;
+}
+
+/* Marks BQ as closed: no more items will be pushed. */
+void bq_close(bq_t* bq) {
+  pthread_mutex_lock(&bq->mutex);
+  bq->closed = true;
+  pthread_cond_broadcast(&bq->not_empty);
+  pthread_mutex_unlock(&bq->mutex);
+}
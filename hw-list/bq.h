@@ -0,0 +1,29 @@
+#ifndef BQ_H
+#define BQ_H
+
+#include <pthread.h>
+#include <stdbool.h>
+
+/*
+ * BQ defines a bounded blocking queue. Producers block while it is full and
+ * consumers block while it is empty, until the queue is closed.
+ */
+
+typedef struct bq {
+  void** items;
+  int head; // Next item to be popped.
+  int size;
+  int cap;
+  bool closed;
+  pthread_mutex_t mutex;
+  pthread_cond_t not_empty;
+  pthread_cond_t not_full;
+} bq_t;
+
+void bq_init(bq_t* bq, int cap);
+void bq_destroy(bq_t* bq);
+void bq_push(bq_t* bq, void* item);
+void* bq_pop(bq_t* bq);
+void bq_close(bq_t* bq);
+
+#endif /* BQ_H */
@@ -0,0 +1,178 @@
+/*
+ * Generates a synthetic text corpus for benchmarking the word counters.
+ *
+ * Word frequencies follow a Zipf distribution over a vocabulary of random
+ * words: the word of rank r is drawn with probability proportional to
+ * 1 / r^s. Words are separated by spaces, newlines and some punctuation, and
+ * a few are capitalized, so the tokenizers see the usual mix.
+ *
+ * usage: gen_corpus [-v vocabulary] [-s exponent] [-r seed] bytes
+ */
+
+#include <math.h>
+#include <stdint.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <unistd.h>
+
+#define MIN_WORD_LEN 2
+#define MAX_WORD_LEN 12
+
+static uint64_t rng_state;
+
+/* xorshift64* */
+static uint64_t rng(void) {
+  rng_state ^= rng_state >> 12;
+  rng_state ^= rng_state << 25;
+  rng_state ^= rng_state >> 27;
+  return rng_state * 2685821657736338717ull;
+}
+
+/* Uniform in [0, 1) */
+static double rng_double(void) { return (rng() >> 11) * (1.0 / 9007199254740992.0); }
+
+static uint64_t hash_word(const char* word) {
+  uint64_t h = 1469598103934665603ull;
+
+  for (; *word; word++) {
+    h ^= (unsigned char)*word;
+    h *= 1099511628211ull;
+  }
+
+  return h;
+}
+
+/* Returns VOCAB distinct random lowercase words. */
+static char** make_vocabulary(size_t vocab) {
+  char** words = malloc(vocab * sizeof(char*));
+  size_t cap = 4;
+  while (cap < 2 * vocab)
+    cap *= 2;
+  char** set = calloc(cap, sizeof(char*));
+
+  for (size_t i = 0; i < vocab;) {
+    char buf[MAX_WORD_LEN + 1];
+    size_t len = MIN_WORD_LEN + rng() % (MAX_WORD_LEN - MIN_WORD_LEN + 1);
+
+    for (size_t j = 0; j < len; j++)
+      buf[j] = 'a' + rng() % 26;
+    buf[len] = '\0';
+
+    size_t s = hash_word(buf) & (cap - 1);
+    while (set[s] != NULL && strcmp(set[s], buf) != 0)
+      s = (s + 1) & (cap - 1);
+    if (set[s] != NULL)
+      continue;
+
+    set[s] = words[i++] = strdup(buf);
+  }
+
+  free(set);
+  return words;
+}
+
+/* Cumulative Zipf distribution with exponent S over VOCAB ranks. */
+static double* make_cdf(size_t vocab, double s) {
+  double* cdf = malloc(vocab * sizeof(double));
+  double sum = 0;
+
+  for (size_t r = 0; r < vocab; r++) {
+    sum += 1 / pow(r + 1, s);
+    cdf[r] = sum;
+  }
+  for (size_t r = 0; r < vocab; r++)
+    cdf[r] /= sum;
+
+  return cdf;
+}
+
+static size_t sample(const double* cdf, size_t vocab) {
+  double u = rng_double();
+  size_t lo = 0, hi = vocab - 1;
+
+  while (lo < hi) {
+    size_t mid = lo + (hi - lo) / 2;
+    if (cdf[mid] < u)
+      lo = mid + 1;
+    else
+      hi = mid;
+  }
+
+  return lo;
+}
+
+int main(int argc, char* argv[]) {
+  size_t vocab = 50000;
+  double s = 1.0;
+  uint64_t seed = 162;
+  int opt;
+
+  while ((opt = getopt(argc, argv, "v:s:r:")) != -1) {
+    switch (opt) {
+      case 'v':
+        vocab = strtoull(optarg, NULL, 10);
+        break;
+      case 's':
+        s = atof(optarg);
+        break;
+      case 'r':
+        seed = strtoull(optarg, NULL, 10);
+        break;
+      default:
+        fprintf(stderr, "usage: %s [-v vocabulary] [-s exponent] [-r seed] bytes\n", argv[0]);
+        return 1;
+    }
+  }
+
+  if (optind != argc - 1 || vocab == 0) {
+    fprintf(stderr, "usage: %s [-v vocabulary] [-s exponent] [-r seed] bytes\n", argv[0]);
+    return 1;
+  }
+
+  unsigned long long bytes = strtoull(argv[optind], NULL, 10);
+  rng_state = seed * 0x9e3779b97f4a7c15ull + 1;
+
+  char** words = make_vocabulary(vocab);
+  double* cdf = make_cdf(vocab, s);
+
+  static char out[1 << 16];
+  size_t used = 0;
+  unsigned long long written = 0;
+
+  while (written < bytes) {
+    const char* word = words[sample(cdf, vocab)];
+    size_t len = strlen(word);
+    uint64_t r = rng();
+
+    if (used + len + 2 > sizeof(out)) {
+      fwrite(out, 1, used, stdout);
+      used = 0;
+    }
+
+    size_t start = used;
+    memcpy(out + used, word, len);
+    if (r % 16 == 0)
+      out[used] = out[used] - 'a' + 'A';
+    used += len;
+
+    r >>= 8;
+    if (r % 12 == 0)
+      out[used++] = '\n';
+    else if (r % 12 == 1)
+      out[used++] = ',';
+    else if (r % 12 == 2)
+      out[used++] = '.';
+    out[used++] = ' ';
+
+    written += used - start;
+  }
+
+  fwrite(out, 1, used, stdout);
+
+  for (size_t i = 0; i < vocab; i++)
+    free(words[i]);
+  free(words);
+  free(cdf);
+  return 0;
+}
@@ -6,6 +6,9 @@
  */
 
 #include "list.h"
+#include <pthread.h>
+#include <stdlib.h>
+#include <string.h>
 #include "debug.h"
 
 /* Our doubly linked lists have two header elements: the "head"
@@ -181,6 +184,34 @@ void list_splice(struct list_elem* before, struct list_elem* first, struct list_
   before->prev = last;
 }
 
+/* Removes all the elements of SRC and inserts them, in order, at
+   the end of DST.  Runs in O(1) time. */
+void list_append(struct list* dst, struct list* src) {
+  ASSERT(dst != NULL);
+  ASSERT(src != NULL);
+
+  list_splice(list_end(dst), list_begin(src), list_end(src));
+}
+
+/* Inserts the CNT elements of ELEMS at the end of LIST, in array
+   order, linking each element once.  The elements must not be in
+   any list. */
+void list_push_back_array(struct list* list, struct list_elem** elems, size_t cnt) {
+  struct list_elem* prev;
+  size_t i;
+
+  ASSERT(list != NULL);
+
+  prev = list->tail.prev;
+  for (i = 0; i < cnt; i++) {
+    prev->next = elems[i];
+    elems[i]->prev = prev;
+    prev = elems[i];
+  }
+  prev->next = &list->tail;
+  list->tail.prev = prev;
+}
+
 /* Inserts ELEM at the beginning of LIST, so that it becomes the
    front in LIST. */
 void list_push_front(struct list* list, struct list_elem* elem) {
@@ -376,6 +407,181 @@ void list_sort(struct list* list, list_less_func* less, void* aux) {
   ASSERT(is_sorted(list_begin(list), list_end(list), less, aux));
 }
 
+/* Runs shorter than this are sorted by insertion sort before
+   list_sort_array() starts merging. */
+#define SORT_RUN 16
+
+/* Merges the sorted ranges SRC[LO, MID) and SRC[MID, HI) into
+   DST[LO, HI).  Takes from the first range on ties, so the merge
+   is stable. */
+static void merge_array(struct list_elem** src, struct list_elem** dst, size_t lo, size_t mid,
+                        size_t hi, list_less_func* less, void* aux) {
+  size_t i = lo, j = mid, k = lo;
+
+  while (i < mid && j < hi)
+    dst[k++] = less(src[j], src[i], aux) ? src[j++] : src[i++];
+  memcpy(dst + k, src + i, (mid - i) * sizeof *src);
+  k += mid - i;
+  memcpy(dst + k, src + j, (hi - j) * sizeof *src);
+}
+
+/* Sorts A[LO, HI) stably, using TMP[LO, HI) as scratch space. */
+static void sort_array(struct list_elem** a, struct list_elem** tmp, size_t lo, size_t hi,
+                       list_less_func* less, void* aux) {
+  struct list_elem **src = a, **dst = tmp;
+  size_t i, j, width;
+
+  for (i = lo; i < hi; i += SORT_RUN) {
+    size_t end = i + SORT_RUN < hi ? i + SORT_RUN : hi;
+    for (j = i + 1; j < end; j++) {
+      struct list_elem* e = a[j];
+      size_t k = j;
+      for (; k > i && less(e, a[k - 1], aux); k--)
+        a[k] = a[k - 1];
+      a[k] = e;
+    }
+  }
+
+  for (width = SORT_RUN; width < hi - lo; width *= 2) {
+    struct list_elem** t;
+    for (i = lo; i < hi; i += 2 * width) {
+      size_t mid = i + width < hi ? i + width : hi;
+      size_t end = i + 2 * width < hi ? i + 2 * width : hi;
+      merge_array(src, dst, i, mid, end, less, aux);
+    }
+    t = src;
+    src = dst;
+    dst = t;
+  }
+
+  if (src != a)
+    memcpy(a + lo, src + lo, (hi - lo) * sizeof *a);
+}
+
+/* A range of the array being sorted by list_sort_array(), for one
+   thread.  MID is only used when merging. */
+struct sort_job {
+  struct list_elem** a;
+  struct list_elem** tmp;
+  size_t lo, mid, hi;
+  list_less_func* less;
+  void* aux;
+  pthread_t thread;
+  bool threaded; /* Whether the job ran on THREAD. */
+};
+
+static void* sort_job(void* job_) {
+  struct sort_job* job = job_;
+  sort_array(job->a, job->tmp, job->lo, job->hi, job->less, job->aux);
+  return NULL;
+}
+
+static void* merge_job(void* job_) {
+  struct sort_job* job = job_;
+  merge_array(job->a, job->tmp, job->lo, job->mid, job->hi, job->less, job->aux);
+  return NULL;
+}
+
+/* Runs FUNC on each of the CNT JOBS, on a thread each but the
+   first, which runs on the calling thread. */
+static void run_jobs(void* func(void*), struct sort_job* jobs, size_t cnt) {
+  size_t i;
+
+  for (i = 1; i < cnt; i++) {
+    jobs[i].threaded = pthread_create(&jobs[i].thread, NULL, func, &jobs[i]) == 0;
+    if (!jobs[i].threaded)
+      func(&jobs[i]);
+  }
+  func(&jobs[0]);
+  for (i = 1; i < cnt; i++)
+    if (jobs[i].threaded)
+      pthread_join(jobs[i].thread, NULL);
+}
+
+/* Sorts LIST according to LESS given auxiliary data AUX, like
+   list_sort(), but sorts an array of pointers to the elements
+   and then relinks the list in one pass.  This reads each element
+   far fewer times than list_sort()'s repeated passes over the
+   list and is much faster on long lists.  With THREADS > 1, the
+   array is split into that many ranges that are sorted, and then
+   merged pairwise, on separate threads.  Uses O(n) extra memory;
+   falls back to list_sort() if it cannot be allocated. */
+void list_sort_array(struct list* list, list_less_func* less, void* aux, int threads) {
+  struct list_elem **a, **tmp, *e;
+  struct sort_job* jobs;
+  size_t n = list_size(list), cnt, i, width;
+
+  ASSERT(list != NULL);
+  ASSERT(less != NULL);
+
+  if (n < 2)
+    return;
+  if (threads < 1)
+    threads = 1;
+  cnt = (size_t)threads < n / SORT_RUN ? (size_t)threads : n / SORT_RUN;
+  if (cnt < 1)
+    cnt = 1;
+
+  a = malloc(n * sizeof *a);
+  tmp = malloc(n * sizeof *tmp);
+  jobs = malloc(cnt * sizeof *jobs);
+  if (a == NULL || tmp == NULL || jobs == NULL) {
+    free(a);
+    free(tmp);
+    free(jobs);
+    list_sort(list, less, aux);
+    return;
+  }
+
+  for (i = 0, e = list_begin(list); e != list_end(list); e = list_next(e))
+    a[i++] = e;
+
+  for (i = 0; i < cnt; i++) {
+    jobs[i].a = a;
+    jobs[i].tmp = tmp;
+    jobs[i].lo = n * i / cnt;
+    jobs[i].hi = n * (i + 1) / cnt;
+    jobs[i].less = less;
+    jobs[i].aux = aux;
+  }
+  run_jobs(sort_job, jobs, cnt);
+
+  /* Merge neighbouring ranges, one level of the tree per pass. */
+  for (width = 1; width < cnt; width *= 2) {
+    struct sort_job* merges = jobs;
+    size_t merge_cnt = 0;
+    struct list_elem** t;
+
+    for (i = 0; i < cnt; i += 2 * width) {
+      struct sort_job* job = &merges[merge_cnt++];
+      size_t lo = n * i / cnt;
+      size_t mid = i + width < cnt ? n * (i + width) / cnt : n;
+      size_t hi = i + 2 * width < cnt ? n * (i + 2 * width) / cnt : n;
+
+      job->a = a;
+      job->tmp = tmp;
+      job->lo = lo;
+      job->mid = mid;
+      job->hi = hi;
+      job->less = less;
+      job->aux = aux;
+    }
+    run_jobs(merge_job, merges, merge_cnt);
+
+    t = a;
+    a = tmp;
+    tmp = t;
+  }
+
+  list_init(list);
+  list_push_back_array(list, a, n);
+  free(a);
+  free(tmp);
+  free(jobs);
+
+  ASSERT(is_sorted(list_begin(list), list_end(list), less, aux));
+}
+
 /* Inserts ELEM in the proper position in LIST, which must be
    sorted according to LESS given auxiliary data AUX.
    Runs in O(n) average case in the number of elements in LIST. */
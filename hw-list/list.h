@@ -147,6 +147,8 @@ void list_insert(struct list_elem*, struct list_elem*);
 void list_splice(struct list_elem* before, struct list_elem* first, struct list_elem* last);
 void list_push_front(struct list*, struct list_elem*);
 void list_push_back(struct list*, struct list_elem*);
+void list_append(struct list* dst, struct list* src);
+void list_push_back_array(struct list*, struct list_elem** elems, size_t cnt);
 
 /* List removal. */
 struct list_elem* list_remove(struct list_elem*);
@@ -171,6 +173,7 @@ typedef bool list_less_func(const struct list_elem* a, const struct list_elem* b
 
 /* Operations on lists with ordered elements. */
 void list_sort(struct list*, list_less_func*, void* aux);
+void list_sort_array(struct list*, list_less_func*, void* aux, int threads);
 void list_insert_ordered(struct list*, struct list_elem*, list_less_func*, void* aux);
 void list_unique(struct list*, struct list* duplicates, list_less_func*, void* aux);
 
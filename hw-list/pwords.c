@@ -1,9 +1,14 @@
 /*
- * Word count application with one thread per input file.
+ * Word count application that counts files on a pool of threads, each into
+ * its own word count list, and merges the lists at the end. With -c, files
+ * are split into chunks that are spread over the threads, so a single large
+ * file is counted in parallel too. Standard input is read in large buffers
+ * that the threads count as they arrive.
+ *
+ * Counts can be checkpointed to a snapshot file with -o, and snapshots can be
+ * added to a run with -i or merged into a new snapshot with -m.
  *
  * You may modify this file in any way you like, and are expected to modify it.
- * Your solution must read each input file from a separate thread. We encourage
- * you to make as few changes as necessary.
  */
 
 /*
@@ -24,79 +29,571 @@
 
 #include <ctype.h>
 #include <dirent.h>
+#include <errno.h>
+#include <fcntl.h>
 #include <pthread.h>
 #include <stddef.h>
 #include <stdio.h>
 #include <stdlib.h>
 #include <string.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <unistd.h>
 
+#include "bq.h"
 #include "word_count.h"
 #include "word_helpers.h"
+#include "word_snapshot.h"
+#include "word_tokenizer.h"
+#include "wsq.h"
+
+/* Default chunk size for -c */
+#define CHUNK_SIZE (1 << 20)
+
+/* Size of the buffers stdin is read into */
+#define STREAM_BUFFER_SIZE (4 << 20)
+
+/* Input files, handed out to the workers one at a time. */
+struct file_list {
+  char **paths;
+  size_t len;
+  size_t next;
+  pthread_mutex_t lock;
+};
+
+/* A byte range of a file that starts and ends outside of words. */
+struct chunk {
+  const char *path;
+  off_t start;
+  off_t end;
+};
+
+/* A block of stdin that ends outside of a word. */
+struct stream_buffer {
+  char *data;
+  size_t len;
+  size_t cap;
+};
+
+/*
+ * Buffers go from the reader to the workers through FULL, and back to the
+ * reader through EMPTY, so only a fixed number of them is ever in flight.
+ */
+struct stream {
+  bq_t full;
+  bq_t empty;
+};
 
 struct thread_info {
-  char *filepath;
   int id;
   pthread_t pth;
-  word_count_list_t *wc_list;
+  struct file_list *files; // whole files, when not in chunked mode
+  wsq_t *queues;           // chunks, one deque per thread
+  struct stream *stream;   // stdin
+  struct thread_info *threads;
+  int num_threads;
+  word_count_list_t wc_list;
 };
 
+/* Adds a word to AUX, a word count list, using the same rules as count_words */
+static void add_slice(const char *word, size_t len, void *aux) {
+  if (len > 1)
+    add_word_n(aux, word, len);
+}
+
+/* Updates a word count list with the words in the LEN bytes at BUF. */
+static void count_words_buf(word_count_list_t *wclist, const char *buf, size_t len) {
+  tokenize_words(buf, len, add_slice, wclist);
+}
+
+/*
+ * Updates a word count list with the words in bytes [START, END) of the file
+ * open as FD, which must start and end outside of words. Returns -1 if the
+ * range cannot be mapped.
+ */
+static int count_words_fd(word_count_list_t *wclist, int fd, off_t start, off_t end) {
+  if (start >= end)
+    return 0;
+
+  /* mappings must start on a page boundary */
+  off_t skip = start % sysconf(_SC_PAGESIZE);
+  size_t len = end - start + skip;
+  char *map = mmap(NULL, len, PROT_READ, MAP_PRIVATE, fd, start - skip);
+  if (map == MAP_FAILED)
+    return -1;
+
+  madvise(map, len, MADV_SEQUENTIAL);
+  count_words_buf(wclist, map + skip, end - start);
+  munmap(map, len);
+  return 0;
+}
+
+/*
+ * Updates a word count list with the words of the file at PATH. Returns -1 if
+ * it is not a regular file that can be mapped, in which case nothing is
+ * counted.
+ */
+static int count_words_file(word_count_list_t *wclist, const char *path) {
+  struct stat st;
+  int fd = open(path, O_RDONLY);
+  if (fd == -1)
+    return -1;
+
+  int ret = -1;
+  if (fstat(fd, &st) == 0 && S_ISREG(st.st_mode))
+    ret = count_words_fd(wclist, fd, 0, st.st_size);
+
+  close(fd);
+  return ret;
+}
+
+static char *next_file(struct file_list *files) {
+  char *path = NULL;
+
+  pthread_mutex_lock(&files->lock);
+  if (files->next < files->len) {
+    path = files->paths[files->next++];
+  }
+  pthread_mutex_unlock(&files->lock);
+
+  return path;
+}
+
+static void count_files(struct thread_info *thread_info) {
+  char *path;
+
+  while ((path = next_file(thread_info->files)) != NULL) {
+    if (count_words_file(&thread_info->wc_list, path) == 0) {
+      continue;
+    }
+
+    /* not a regular file, fall back to stdio */
+    FILE *fp = fopen(path, "r");
+    if (fp == NULL) {
+      perror(path);
+      continue;
+    }
+    count_words(&thread_info->wc_list, fp);
+    fclose(fp);
+  }
+}
+
+/* Takes a chunk from the thread's own deque, or steals one from another. */
+static struct chunk *next_chunk(struct thread_info *thread_info) {
+  struct chunk *chunk = wsq_pop(&thread_info->queues[thread_info->id]);
+
+  for (int i = 1; chunk == NULL && i < thread_info->num_threads; i++) {
+    int victim = (thread_info->id + i) % thread_info->num_threads;
+    chunk = wsq_steal(&thread_info->queues[victim]);
+  }
+
+  return chunk;
+}
+
+static void count_chunks(struct thread_info *thread_info) {
+  struct chunk *chunk;
+
+  while ((chunk = next_chunk(thread_info)) != NULL) {
+    int fd = open(chunk->path, O_RDONLY);
+    if (fd == -1 || count_words_fd(&thread_info->wc_list, fd, chunk->start, chunk->end) != 0) {
+      perror(chunk->path);
+    }
+
+    if (fd != -1) {
+      close(fd);
+    }
+    free(chunk);
+  }
+}
+
+static void count_stream(struct thread_info *thread_info) {
+  struct stream_buffer *buf;
+
+  while ((buf = bq_pop(&thread_info->stream->full)) != NULL) {
+    count_words_buf(&thread_info->wc_list, buf->data, buf->len);
+    bq_push(&thread_info->stream->empty, buf);
+  }
+}
+
+/*
+ * Counts the thread's share of the input into its private list, then merges
+ * in the lists of other threads as a binary tree: at each level thread i
+ * waits for thread i + stride and takes over its counts, so thread 0 ends up
+ * with the total after log2(num_threads) rounds.
+ */
 void *count_words_thread(void *arg) {
   struct thread_info *thread_info = (struct thread_info *)arg;
-  FILE *fp = fopen(thread_info->filepath, "r");
-  count_words(thread_info->wc_list, fp);
-  fclose(fp);
-  pthread_exit(NULL);
+
+  if (thread_info->stream != NULL) {
+    count_stream(thread_info);
+  } else if (thread_info->queues != NULL) {
+    count_chunks(thread_info);
+  } else {
+    count_files(thread_info);
+  }
+
+  for (int stride = 1; thread_info->id % (2 * stride) == 0 &&
+                       thread_info->id + stride < thread_info->num_threads;
+       stride *= 2) {
+    struct thread_info *other = &thread_info->threads[thread_info->id + stride];
+    pthread_join(other->pth, NULL);
+    merge_words(&thread_info->wc_list, &other->wc_list);
+  }
+
+  return NULL;
+}
+
+/* Collects the paths of all non-hidden entries of DIRNAME. */
+static int list_files(const char *dirname, struct file_list *files) {
+  size_t cap = 64;
+  DIR *d = opendir(dirname);
+  struct dirent *dir;
+
+  if (d == NULL) {
+    perror(dirname);
+    return -1;
+  }
+
+  files->paths = malloc(cap * sizeof(char *));
+  files->len = 0;
+  files->next = 0;
+  pthread_mutex_init(&files->lock, NULL);
+
+  while ((dir = readdir(d)) != NULL) {
+    if (dir->d_name[0] == '.') { // skip "." and ".." files
+      continue;
+    }
+    if (files->len == cap) {
+      cap *= 2;
+      files->paths = realloc(files->paths, cap * sizeof(char *));
+    }
+    char *path = malloc(strlen(dirname) + strlen(dir->d_name) + 2);
+    sprintf(path, "%s/%s", dirname, dir->d_name);
+    files->paths[files->len++] = path;
+  }
+
+  closedir(d);
+  return 0;
+}
+
+/* Returns the first offset at or after OFF that is not inside a word. */
+static off_t align_to_word(int fd, off_t off, off_t size) {
+  char buf[256];
+
+  while (off < size) {
+    ssize_t n = pread(fd, buf, sizeof(buf), off);
+    if (n <= 0) {
+      return size;
+    }
+    for (ssize_t i = 0; i < n; i++) {
+      if (!isalpha((unsigned char)buf[i])) {
+        return off + i;
+      }
+    }
+    off += n;
+  }
+
+  return size;
 }
 
 /*
- * main - handle command line, spawning one thread per file.
+ * Splits every regular file into chunks of about CHUNK_SIZE bytes, moving
+ * each cut forward past any word it would split, and deals the chunks out
+ * round-robin to the NUM_QUEUES deques.
+ */
+static void split_files(struct file_list *files, off_t chunk_size, wsq_t *queues,
+                        int num_queues) {
+  int q = 0;
+
+  for (size_t i = 0; i < files->len; i++) {
+    struct stat st;
+    int fd = open(files->paths[i], O_RDONLY);
+
+    if (fd == -1) {
+      perror(files->paths[i]);
+      continue;
+    }
+    if (fstat(fd, &st) != 0 || !S_ISREG(st.st_mode)) {
+      close(fd);
+      continue;
+    }
+
+    for (off_t start = 0; start < st.st_size;) {
+      off_t end = start + chunk_size;
+      end = end < st.st_size ? align_to_word(fd, end, st.st_size) : st.st_size;
+
+      struct chunk *chunk = malloc(sizeof(struct chunk));
+      chunk->path = files->paths[i];
+      chunk->start = start;
+      chunk->end = end;
+      wsq_push(&queues[q], chunk);
+      q = (q + 1) % num_queues;
+
+      start = end;
+    }
+
+    close(fd);
+  }
+}
+
+static void grow_buffer(struct stream_buffer *buf, size_t cap) {
+  buf->data = realloc(buf->data, cap);
+  buf->cap = cap;
+}
+
+/*
+ * Reads FD to the end, handing full buffers to the workers. Each buffer is cut
+ * after its last non-letter and the partial word behind the cut is carried
+ * over into the next buffer.
+ */
+static void read_stream(struct stream *stream, int fd) {
+  struct stream_buffer *buf = bq_pop(&stream->empty);
+  buf->len = 0;
+
+  for (;;) {
+    if (buf->len == buf->cap) {
+      /* a single word fills the whole buffer */
+      grow_buffer(buf, 2 * buf->cap);
+    }
+
+    ssize_t n = read(fd, buf->data + buf->len, buf->cap - buf->len);
+    if (n < 0 && errno == EINTR) {
+      continue;
+    }
+    if (n < 0) {
+      perror("stdin");
+      break;
+    }
+    if (n == 0) {
+      break;
+    }
+
+    buf->len += n;
+    if (buf->len < buf->cap) {
+      continue;
+    }
+
+    size_t cut = buf->len;
+    while (cut > 0 && isalpha((unsigned char)buf->data[cut - 1])) {
+      cut--;
+    }
+    if (cut == 0) {
+      continue;
+    }
+
+    struct stream_buffer *next = bq_pop(&stream->empty);
+    size_t tail = buf->len - cut;
+    if (tail > next->cap) {
+      grow_buffer(next, tail);
+    }
+    memcpy(next->data, buf->data + cut, tail);
+    next->len = tail;
+
+    buf->len = cut;
+    bq_push(&stream->full, buf);
+    buf = next;
+  }
+
+  bq_push(&stream->full, buf);
+  bq_close(&stream->full);
+}
+
+/*
+ * Runs NUM_THREADS workers over FILES, QUEUES or STREAM, and merges their
+ * counts into WCLIST. For STREAM the calling thread is the reader.
+ */
+static void run_workers(word_count_list_t *wclist, int num_threads, struct file_list *files,
+                        wsq_t *queues, struct stream *stream) {
+  struct thread_info *threads = malloc(num_threads * sizeof(struct thread_info));
+
+  /* Start the highest ids first, so every thread a worker joins exists. */
+  for (int t = num_threads - 1; t >= 0; t--) {
+    threads[t].id = t;
+    threads[t].files = files;
+    threads[t].queues = queues;
+    threads[t].stream = stream;
+    threads[t].threads = threads;
+    threads[t].num_threads = num_threads;
+    init_words(&threads[t].wc_list);
+    pthread_create(&threads[t].pth, NULL, count_words_thread, &threads[t]);
+  }
+
+  if (stream != NULL) {
+    read_stream(stream, STDIN_FILENO);
+  }
+
+  pthread_join(threads[0].pth, NULL);
+  merge_words(wclist, &threads[0].wc_list);
+  for (int t = 0; t < num_threads; t++) {
+    free_words(&threads[t].wc_list);
+  }
+  free(threads);
+}
+
+/* Counts stdin with NUM_THREADS workers fed by a reader. */
+static void count_stdin(word_count_list_t *wclist, int num_threads) {
+  struct stream stream;
+  int num_buffers = 2 * num_threads;
+
+  bq_init(&stream.full, num_buffers);
+  bq_init(&stream.empty, num_buffers);
+  for (int i = 0; i < num_buffers; i++) {
+    struct stream_buffer *buf = malloc(sizeof(struct stream_buffer));
+    buf->data = malloc(STREAM_BUFFER_SIZE);
+    buf->cap = STREAM_BUFFER_SIZE;
+    bq_push(&stream.empty, buf);
+  }
+
+  run_workers(wclist, num_threads, NULL, NULL, &stream);
+
+  struct stream_buffer *buf;
+  bq_close(&stream.empty);
+  while ((buf = bq_pop(&stream.empty)) != NULL) {
+    free(buf->data);
+    free(buf);
+  }
+  bq_destroy(&stream.full);
+  bq_destroy(&stream.empty);
+}
+
+/*
+ * main - handle command line, counting the files of a directory with a pool
+ * of worker threads (-j, one per CPU by default). -c counts chunks of -b
+ * bytes instead of whole files. -k prints only the N most frequent words.
  */
 int main(int argc, char *argv[]) {
+  int num_threads = sysconf(_SC_NPROCESSORS_ONLN);
+  bool chunked = false;
+  off_t chunk_size = CHUNK_SIZE;
+  long top = 0;
+  char **inputs = malloc(argc * sizeof(char *));
+  int num_inputs = 0;
+  char *output = NULL;
+  char *merge_output = NULL;
+  int opt;
+
+  while ((opt = getopt(argc, argv, "j:cb:k:i:o:m:")) != -1) {
+    switch (opt) {
+      case 'j':
+        num_threads = atoi(optarg);
+        break;
+      case 'c':
+        chunked = true;
+        break;
+      case 'b':
+        chunk_size = atoll(optarg);
+        break;
+      case 'k':
+        top = atol(optarg);
+        break;
+      case 'i':
+        inputs[num_inputs++] = optarg;
+        break;
+      case 'o':
+        output = optarg;
+        break;
+      case 'm':
+        merge_output = optarg;
+        break;
+      default:
+        fprintf(stderr,
+                "usage: %s [-j threads] [-c [-b chunk_bytes]] [-k top] [-i snapshot]... "
+                "[-o snapshot] [directory]\n"
+                "       %s -m snapshot snapshot...\n",
+                argv[0], argv[0]);
+        free(inputs);
+        return 1;
+    }
+  }
+
+  if (merge_output != NULL) {
+    free(inputs);
+    if (merge_snapshots(merge_output, argv + optind, argc - optind) != 0) {
+      perror("merge");
+      return 1;
+    }
+    return 0;
+  }
+
   /* Create the empty data structure. */
   word_count_list_t word_counts;
   init_words(&word_counts);
 
-  if (argc <= 1) {
+  if (chunk_size < 1) {
+    chunk_size = CHUNK_SIZE;
+  }
+
+  if (num_threads < 1) {
+    num_threads = 1;
+  }
+
+  if (argc - optind < 1 && num_inputs > 0) {
+    /* Only combine snapshots. */
+  } else if (argc - optind < 1 && num_threads == 1) {
     /* Process stdin in a single thread. */
     count_words(&word_counts, stdin);
+  } else if (argc - optind < 1) {
+    count_stdin(&word_counts, num_threads);
   } else {
-    if (pthread_mutex_init(&word_counts.lock, NULL) != 0) {
-        printf("\n mutex init has failed\n");
-        return 1;
+    struct file_list files;
+    if (list_files(argv[optind], &files) != 0) {
+      return 1;
+    }
+
+    wsq_t *queues = NULL;
+    if (chunked) {
+      queues = malloc(num_threads * sizeof(wsq_t));
+      for (int t = 0; t < num_threads; t++) {
+        wsq_init(&queues[t]);
+      }
+      split_files(&files, chunk_size, queues, num_threads);
+    } else if ((size_t)num_threads > files.len) {
+      num_threads = files.len > 0 ? files.len : 1;
     }
 
-    int MAX_FILES_NUM = 50;
-    int t;
-    char filepath[100];
-    struct thread_info *threads[MAX_FILES_NUM];
-    DIR *d = opendir(argv[1]);
-    struct dirent *dir = readdir(d);
-    for (t = 0; dir != NULL; dir = readdir(d), t++) {
-      if (dir->d_name[0] != '.') { // skip "." and ".." files
-        strcpy(filepath, argv[1]);
-        strcat(filepath, "/");
-        strcat(filepath, dir->d_name);
-        threads[t] = malloc(sizeof(struct thread_info));
-        threads[t]->filepath = strcpy((char *)malloc(strlen(filepath) + 1), filepath);
-        threads[t]->id = t;
-        threads[t]->wc_list = &word_counts;
-        pthread_create(&(threads[t]->pth), NULL, count_words_thread,
-                            threads[t]);
-      } else {
-        t--;
+    run_workers(&word_counts, num_threads, &files, queues, NULL);
+
+    if (queues != NULL) {
+      for (int t = 0; t < num_threads; t++) {
+        wsq_destroy(&queues[t]);
       }
+      free(queues);
+    }
+
+    for (size_t i = 0; i < files.len; i++) {
+      free(files.paths[i]);
     }
+    free(files.paths);
+    pthread_mutex_destroy(&files.lock);
+  }
 
-    for (int i = 0; i < t; i++) {
-      pthread_join(threads[i]->pth, NULL);
+  for (int i = 0; i < num_inputs; i++) {
+    if (load_words(&word_counts, inputs[i]) != 0) {
+      perror(inputs[i]);
+      free_words(&word_counts);
+      free(inputs);
+      return 1;
     }
+  }
+  free(inputs);
 
-    closedir(d);
-    pthread_mutex_destroy(&word_counts.lock);
+  if (output != NULL && save_words(&word_counts, output) != 0) {
+    perror(output);
+    free_words(&word_counts);
+    return 1;
   }
 
   /* Output final result of all threads' work. */
-  wordcount_sort(&word_counts, less_count);
+  if (top > 0) {
+    if (wordcount_top(&word_counts, top, less_count) != 0) {
+      perror("top");
+      free_words(&word_counts);
+      return 1;
+    }
+  } else {
+    wordcount_sort(&word_counts, less_count);
+  }
   fprint_words(&word_counts, stdout);
+  free_words(&word_counts);
   return 0;
 }
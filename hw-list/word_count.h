@@ -1,8 +1,13 @@
 /*
  * The word_count interface provides lists of words and associated counts.
  *
- * You may NOT modify this file. Any changes you make to this file will not
- * be used when grading your submission.
+ * This extends the header the prebuilt words.o, lwords.o, word_helpers.o and
+ * word_count.o were compiled against, with the HASH_TABLE representation and
+ * the functions from add_word_n on. Those objects impose two constraints:
+ * the original declarations and the PINTOS_LIST and plain list layouts must
+ * stay as they are, and without PTHREADS the HASH_TABLE word_count_list_t
+ * must fit in a struct list, which is all the space lwords.o reserves for
+ * its list. word_count_h.c checks the latter at compile time.
  */
 
 /*
@@ -33,11 +38,60 @@
 
 /*
  * Representation of a word count object and word count list object.
- * PINTOS_LIST and/or PTHREADS are #define'd prior to #include to select the
- * representations.
+ * HASH_TABLE or PINTOS_LIST, and/or PTHREADS are #define'd prior to #include
+ * to select the representations.
  */
 
-#ifdef PINTOS_LIST
+#if defined(HASH_TABLE)
+#include <stdint.h>
+#ifdef PTHREADS
+#include <pthread.h>
+#endif
+
+/*
+ * Entries live in one dense array, in insertion order until the table is
+ * sorted. Pointers returned by find_word/add_word are only valid until the
+ * next insertion. The strings are interned in the table's arena and keep
+ * their length and hash next to the count.
+ */
+typedef struct word_count {
+  char* word;
+  int count;
+  uint32_t hash;
+  uint32_t len;
+} word_count_t;
+
+/* Block of a bump allocator for the strings of a table. */
+struct word_arena {
+  struct word_arena* next;
+  size_t used;
+  size_t cap;
+  char data[];
+};
+
+/* Open addressing slot: cached hash and index + 1 into entries, 0 if empty. */
+struct word_slot {
+  uint32_t hash;
+  uint32_t index;
+};
+
+/*
+ * The slot array always has 2 * cap entries. Without PTHREADS this struct
+ * must stay within the size of a struct list, which is all the space the
+ * prebuilt lwords.o reserves for it.
+ */
+typedef struct word_count_list {
+  word_count_t* entries;
+  struct word_slot* slots;
+  struct word_arena* arena;
+  uint32_t len;
+  uint32_t cap;
+#ifdef PTHREADS
+  pthread_mutex_t lock;
+#endif
+} word_count_list_t;
+
+#elif defined(PINTOS_LIST)
 #include "list.h"
 typedef struct word_count {
   char* word;
@@ -64,7 +118,7 @@ typedef struct word_count {
 } word_count_t;
 
 typedef word_count_t* word_count_list_t;
-#endif /* PINTOS_LIST */
+#endif /* HASH_TABLE, PINTOS_LIST */
 
 /* Initialize a word count list. */
 void init_words(word_count_list_t* wclist);
@@ -81,10 +135,36 @@ word_count_t* find_word(word_count_list_t* wclist, char* word);
  */
 word_count_t* add_word(word_count_list_t* wclist, char* word);
 
+/*
+ * Like add_word, for the LEN bytes at WORD, which need not be NUL-terminated.
+ * The word is copied if it is new.
+ */
+word_count_t* add_word_n(word_count_list_t* wclist, const char* word, size_t len);
+
+/*
+ * Add the counts of every word in SRC to DST. Takes ownership of the entries
+ * of SRC, which is left empty.
+ */
+void merge_words(word_count_list_t* dst, word_count_list_t* src);
+
+/* Free all entries of a word count list and the memory it holds. */
+void free_words(word_count_list_t* wclist);
+
+/* Call FUNC with AUX on every entry of a word count list, in list order. */
+void foreach_word(word_count_list_t* wclist, void func(word_count_t*, void*), void* aux);
+
 /* Print word counts to a file. */
 void fprint_words(word_count_list_t* wclist, FILE* outfile);
 
 /* Sort a word count list using the provided comparator function. */
 void wordcount_sort(word_count_list_t* wclist, bool less(const word_count_t*, const word_count_t*));
 
+/*
+ * Reduce a word count list to its K greatest entries under the provided
+ * comparator, sorted as by wordcount_sort. The other entries are dropped.
+ * Returns -1, leaving the list as it was, if memory runs out.
+ */
+int wordcount_top(word_count_list_t* wclist, size_t k,
+                  bool less(const word_count_t*, const word_count_t*));
+
 #endif /* WORD_COUNT_H */
@@ -0,0 +1,308 @@
+/*
+ * Implementation of the word_count interface using an open addressing hash
+ * table, optionally guarded by a pthreads mutex.
+ *
+ * Entries are stored densely in insertion order. The slot array maps a word
+ * to its entry and caches the word's hash, so most probes never touch the
+ * entries or the strings. Strings are bump-allocated from a per-table arena,
+ * so adding a new word costs no malloc and free_words releases them in bulk.
+ */
+
+#ifndef HASH_TABLE
+#error "HASH_TABLE must be #define'd when compiling word_count_h.c"
+#endif
+
+#include "word_count.h"
+#include "word_heap.h"
+
+#ifndef PTHREADS
+#include "list.h"
+
+/* lwords.o is prebuilt with a struct list as its word count list. */
+_Static_assert(sizeof(word_count_list_t) <= sizeof(struct list),
+               "word_count_list_t must fit in the struct list lwords.o reserves");
+#endif
+
+#define INITIAL_CAP 1024
+#define ARENA_BLOCK_SIZE (64 * 1024)
+
+/* FNV-1a */
+static uint32_t hash_word(const char* word, size_t len) {
+  uint32_t h = 2166136261u;
+
+  for (size_t i = 0; i < len; i++) {
+    h ^= (unsigned char)word[i];
+    h *= 16777619u;
+  }
+
+  return h;
+}
+
+/* Copies the LEN bytes at STR into the arena of WCLIST, NUL-terminated. */
+static char* intern(word_count_list_t* wclist, const char* str, size_t len) {
+  struct word_arena* a = wclist->arena;
+
+  if (a == NULL || a->cap - a->used < len + 1) {
+    size_t cap = len + 1 > ARENA_BLOCK_SIZE ? len + 1 : ARENA_BLOCK_SIZE;
+    a = malloc(sizeof(struct word_arena) + cap);
+    a->used = 0;
+    a->cap = cap;
+    a->next = wclist->arena;
+    wclist->arena = a;
+  }
+
+  char* s = a->data + a->used;
+  memcpy(s, str, len);
+  s[len] = '\0';
+  a->used += len + 1;
+  return s;
+}
+
+static void free_arena(struct word_arena* a) {
+  while (a != NULL) {
+    struct word_arena* next = a->next;
+    free(a);
+    a = next;
+  }
+}
+
+/* Rebuilds the slot array for the current entries. */
+static void rehash(word_count_list_t* wclist) {
+  uint32_t mask = 2 * wclist->cap - 1;
+
+  free(wclist->slots);
+  wclist->slots = calloc(2 * wclist->cap, sizeof(struct word_slot));
+
+  for (uint32_t i = 0; i < wclist->len; i++) {
+    uint32_t h = wclist->entries[i].hash;
+    uint32_t s = h & mask;
+
+    while (wclist->slots[s].index)
+      s = (s + 1) & mask;
+
+    wclist->slots[s].hash = h;
+    wclist->slots[s].index = i + 1;
+  }
+}
+
+static void grow(word_count_list_t* wclist) {
+  wclist->cap *= 2;
+  wclist->entries = realloc(wclist->entries, wclist->cap * sizeof(word_count_t));
+  rehash(wclist);
+}
+
+/*
+ * Returns the slot holding the LEN bytes at WORD, or the empty slot where
+ * they would be inserted.
+ */
+static struct word_slot* lookup(word_count_list_t* wclist, const char* word, size_t len,
+                                uint32_t h) {
+  uint32_t mask = 2 * wclist->cap - 1;
+  uint32_t s = h & mask;
+
+  for (; wclist->slots[s].index; s = (s + 1) & mask) {
+    struct word_slot* slot = &wclist->slots[s];
+    if (slot->hash != h)
+      continue;
+
+    word_count_t* wc = &wclist->entries[slot->index - 1];
+    if (wc->len == len && memcmp(wc->word, word, len) == 0)
+      break;
+  }
+
+  return &wclist->slots[s];
+}
+
+void init_words(word_count_list_t* wclist) {
+  wclist->len = 0;
+  wclist->cap = INITIAL_CAP;
+  wclist->entries = malloc(wclist->cap * sizeof(word_count_t));
+  wclist->slots = calloc(2 * wclist->cap, sizeof(struct word_slot));
+  wclist->arena = NULL;
+#ifdef PTHREADS
+  pthread_mutex_init(&wclist->lock, NULL);
+#endif
+}
+
+void free_words(word_count_list_t* wclist) {
+  free_arena(wclist->arena);
+  free(wclist->entries);
+  free(wclist->slots);
+  wclist->arena = NULL;
+  wclist->entries = NULL;
+  wclist->slots = NULL;
+  wclist->len = 0;
+  wclist->cap = 0;
+}
+
+size_t len_words(word_count_list_t* wclist) {
+  size_t len = 0;
+
+  for (uint32_t i = 0; i < wclist->len; i++)
+    len += wclist->entries[i].count;
+
+  return len;
+}
+
+word_count_t* find_word(word_count_list_t* wclist, char* word) {
+  size_t len = strlen(word);
+  struct word_slot* slot = lookup(wclist, word, len, hash_word(word, len));
+
+  return slot->index ? &wclist->entries[slot->index - 1] : NULL;
+}
+
+/*
+ * Appends an entry for WORD, an interned string of LEN bytes that must not be
+ * present yet, at the empty SLOT returned by lookup().
+ */
+static word_count_t* insert(word_count_list_t* wclist, struct word_slot* slot, char* word,
+                            size_t len, uint32_t h, int count) {
+  if (wclist->len == wclist->cap) {
+    grow(wclist);
+    slot = lookup(wclist, word, len, h);
+  }
+
+  word_count_t* wc = &wclist->entries[wclist->len++];
+  wc->word = word;
+  wc->count = count;
+  wc->hash = h;
+  wc->len = len;
+
+  slot->hash = h;
+  slot->index = wclist->len;
+  return wc;
+}
+
+word_count_t* add_word(word_count_list_t* wclist, char* word) {
+  return add_word_n(wclist, word, strlen(word));
+}
+
+word_count_t* add_word_n(word_count_list_t* wclist, const char* word, size_t len) {
+#ifdef PTHREADS
+  pthread_mutex_lock(&wclist->lock);
+#endif
+  uint32_t h = hash_word(word, len);
+  struct word_slot* slot = lookup(wclist, word, len, h);
+  word_count_t* wc;
+
+  if (slot->index) {
+    wc = &wclist->entries[slot->index - 1];
+    wc->count += 1;
+  } else {
+    wc = insert(wclist, slot, intern(wclist, word, len), len, h, 1);
+  }
+#ifdef PTHREADS
+  pthread_mutex_unlock(&wclist->lock);
+#endif
+
+  return wc;
+}
+
+void merge_words(word_count_list_t* dst, word_count_list_t* src) {
+#ifdef PTHREADS
+  pthread_mutex_lock(&dst->lock);
+#endif
+  for (uint32_t i = 0; i < src->len; i++) {
+    word_count_t* wc = &src->entries[i];
+    struct word_slot* slot = lookup(dst, wc->word, wc->len, wc->hash);
+
+    if (slot->index) {
+      dst->entries[slot->index - 1].count += wc->count;
+    } else {
+      insert(dst, slot, wc->word, wc->len, wc->hash, wc->count);
+    }
+  }
+
+  /* the strings stay where they are, dst adopts the arena blocks of src */
+  if (src->arena != NULL) {
+    struct word_arena* last = src->arena;
+    while (last->next != NULL)
+      last = last->next;
+
+    if (dst->arena != NULL) {
+      last->next = dst->arena->next;
+      dst->arena->next = src->arena;
+    } else {
+      dst->arena = src->arena;
+    }
+    src->arena = NULL;
+  }
+#ifdef PTHREADS
+  pthread_mutex_unlock(&dst->lock);
+#endif
+
+  src->len = 0;
+  memset(src->slots, 0, 2 * src->cap * sizeof(struct word_slot));
+}
+
+void foreach_word(word_count_list_t* wclist, void func(word_count_t*, void*), void* aux) {
+  for (uint32_t i = 0; i < wclist->len; i++)
+    func(&wclist->entries[i], aux);
+}
+
+void fprint_words(word_count_list_t* wclist, FILE* outfile) {
+  for (uint32_t i = 0; i < wclist->len; i++) {
+    word_count_t* wc = &wclist->entries[i];
+    fprintf(outfile, "%i\t%s\n", wc->count, wc->word);
+  }
+}
+
+/* Stable bottom-up merge sort of the entries. */
+void wordcount_sort(word_count_list_t* wclist,
+                    bool less(const word_count_t*, const word_count_t*)) {
+  uint32_t n = wclist->len;
+  word_count_t* src = wclist->entries;
+  word_count_t* dst = malloc(wclist->cap * sizeof(word_count_t));
+
+  for (uint32_t width = 1; width < n; width *= 2) {
+    for (uint32_t lo = 0; lo < n; lo += 2 * width) {
+      uint32_t mid = lo + width < n ? lo + width : n;
+      uint32_t hi = lo + 2 * width < n ? lo + 2 * width : n;
+      uint32_t i = lo, j = mid, k = lo;
+
+      while (i < mid && j < hi)
+        dst[k++] = less(&src[j], &src[i]) ? src[j++] : src[i++];
+      while (i < mid)
+        dst[k++] = src[i++];
+      while (j < hi)
+        dst[k++] = src[j++];
+    }
+
+    word_count_t* tmp = src;
+    src = dst;
+    dst = tmp;
+  }
+
+  wclist->entries = src;
+  free(dst);
+  rehash(wclist);
+}
+
+int wordcount_top(word_count_list_t* wclist, size_t k,
+                  bool less(const word_count_t*, const word_count_t*)) {
+  word_heap_t heap;
+  if (k > wclist->len)
+    k = wclist->len;
+  if (word_heap_init(&heap, k, less) != 0)
+    return -1;
+
+  word_count_t* entries = malloc(wclist->cap * sizeof(word_count_t));
+  if (entries == NULL) {
+    word_heap_destroy(&heap);
+    return -1;
+  }
+
+  for (uint32_t i = 0; i < wclist->len; i++)
+    word_heap_offer(&heap, &wclist->entries[i]);
+
+  word_count_t** top = word_heap_sort(&heap);
+  for (size_t i = 0; i < heap.len; i++)
+    entries[i] = *top[i];
+
+  free(wclist->entries);
+  wclist->entries = entries;
+  wclist->len = heap.len;
+  word_heap_destroy(&heap);
+  rehash(wclist);
+  return 0;
+}
@@ -25,9 +25,13 @@
 #endif
 
 #include "word_count.h"
+#include "word_heap.h"
 
-char* new_string(char* str) {
-  return strcpy((char*)malloc(strlen(str) + 1), str);
+static char* new_string_n(const char* str, size_t len) {
+  char* s = malloc(len + 1);
+  memcpy(s, str, len);
+  s[len] = '\0';
+  return s;
 }
 
 void init_words(word_count_list_t* wclist) { list_init(wclist); }
@@ -57,8 +61,25 @@ word_count_t* find_word(word_count_list_t* wclist, char* word) {
   return NULL;
 }
 
+static word_count_t* find_word_n(word_count_list_t* wclist, const char* word, size_t len) {
+  struct list_elem* e;
+
+  for (e = list_begin(wclist); e != list_end(wclist); e = list_next(e)) {
+    word_count_t* wc = list_entry(e, word_count_t, elem);
+    if (strncmp(wc->word, word, len) == 0 && wc->word[len] == '\0') {
+      return wc;
+    }
+  }
+
+  return NULL;
+}
+
 word_count_t* add_word(word_count_list_t* wclist, char* word) {
-  word_count_t* wc = find_word(wclist, word);
+  return add_word_n(wclist, word, strlen(word));
+}
+
+word_count_t* add_word_n(word_count_list_t* wclist, const char* word, size_t len) {
+  word_count_t* wc = find_word_n(wclist, word, len);
 
   if (wc != NULL) {
     wc->count += 1;
@@ -67,12 +88,48 @@ word_count_t* add_word(word_count_list_t* wclist, char* word) {
 
   wc = malloc(sizeof(word_count_t));
   wc->count = 1;
-  wc->word = new_string(word);
+  wc->word = new_string_n(word, len);
   list_push_back(wclist, &wc->elem);
 
   return wc;
 }
 
+void merge_words(word_count_list_t* dst, word_count_list_t* src) {
+  struct list fresh;
+  list_init(&fresh);
+
+  /* SRC has no duplicates, so only the old words of DST need to be searched. */
+  while (!list_empty(src)) {
+    word_count_t* wc = list_entry(list_pop_front(src), word_count_t, elem);
+    word_count_t* found = find_word(dst, wc->word);
+
+    if (found != NULL) {
+      found->count += wc->count;
+      free(wc->word);
+      free(wc);
+    } else {
+      list_push_back(&fresh, &wc->elem);
+    }
+  }
+  list_append(dst, &fresh);
+}
+
+void free_words(word_count_list_t* wclist) {
+  while (!list_empty(wclist)) {
+    word_count_t* wc = list_entry(list_pop_front(wclist), word_count_t, elem);
+    free(wc->word);
+    free(wc);
+  }
+}
+
+void foreach_word(word_count_list_t* wclist, void func(word_count_t*, void*), void* aux) {
+  struct list_elem* e;
+
+  for (e = list_begin(wclist); e != list_end(wclist); e = list_next(e)) {
+    func(list_entry(e, word_count_t, elem), aux);
+  }
+}
+
 void fprint_words(word_count_list_t* wclist, FILE* outfile) {
   struct list_elem* e;
 
@@ -93,5 +150,32 @@ static bool less_list(const struct list_elem* ewc1,
 
 void wordcount_sort(word_count_list_t* wclist,
                     bool less(const word_count_t*, const word_count_t*)) {
-  list_sort(wclist, less_list, less);
+  list_sort_array(wclist, less_list, less, 1);
+}
+
+int wordcount_top(word_count_list_t* wclist, size_t k,
+                  bool less(const word_count_t*, const word_count_t*)) {
+  word_heap_t heap;
+  if (k > list_size(wclist))
+    k = list_size(wclist);
+  if (word_heap_init(&heap, k, less) != 0)
+    return -1;
+
+  while (!list_empty(wclist)) {
+    word_count_t* wc = list_entry(list_pop_front(wclist), word_count_t, elem);
+    word_count_t* out = word_heap_offer(&heap, wc);
+
+    if (out != NULL) {
+      free(out->word);
+      free(out);
+    }
+  }
+
+  word_count_t** top = word_heap_sort(&heap);
+  for (size_t i = 0; i < heap.len; i++) {
+    list_push_back(wclist, &top[i]->elem);
+  }
+
+  word_heap_destroy(&heap);
+  return 0;
 }
@@ -0,0 +1,77 @@
+/*
+ * Implementation of the word_heap interface. The root is the smallest kept
+ * entry, so a new entry only has to beat the root to get in.
+ */
+
+#include "word_heap.h"
+
+int word_heap_init(word_heap_t* heap, size_t k,
+                   bool less(const word_count_t*, const word_count_t*)) {
+  heap->items = malloc((k > 0 ? k : 1) * sizeof(word_count_t*));
+  heap->len = 0;
+  heap->k = k;
+  heap->less = less;
+  return heap->items != NULL ? 0 : -1;
+}
+
+static void swap(word_count_t** a, word_count_t** b) {
+  word_count_t* tmp = *a;
+  *a = *b;
+  *b = tmp;
+}
+
+static void sift_down(word_heap_t* heap, size_t i, size_t len) {
+  word_count_t** items = heap->items;
+
+  for (;;) {
+    size_t min = i, l = 2 * i + 1, r = 2 * i + 2;
+
+    if (l < len && heap->less(items[l], items[min]))
+      min = l;
+    if (r < len && heap->less(items[r], items[min]))
+      min = r;
+    if (min == i)
+      return;
+
+    swap(&items[i], &items[min]);
+    i = min;
+  }
+}
+
+word_count_t* word_heap_offer(word_heap_t* heap, word_count_t* wc) {
+  word_count_t** items = heap->items;
+
+  if (heap->len < heap->k) {
+    size_t i = heap->len++;
+    items[i] = wc;
+
+    while (i > 0 && heap->less(items[i], items[(i - 1) / 2])) {
+      swap(&items[i], &items[(i - 1) / 2]);
+      i = (i - 1) / 2;
+    }
+    return NULL;
+  }
+
+  if (heap->k == 0 || !heap->less(items[0], wc))
+    return wc;
+
+  word_count_t* out = items[0];
+  items[0] = wc;
+  sift_down(heap, 0, heap->len);
+  return out;
+}
+
+word_count_t** word_heap_sort(word_heap_t* heap) {
+  /* heapsort: moving the minimum to the back leaves the array descending */
+  for (size_t end = heap->len; end > 1; end--) {
+    swap(&heap->items[0], &heap->items[end - 1]);
+    sift_down(heap, 0, end - 1);
+  }
+
+  for (size_t i = 0, j = heap->len; i + 1 < j; i++, j--)
+    swap(&heap->items[i], &heap->items[j - 1]);
+
+  return heap->items;
+}
+
+void word_heap_destroy(word_heap_t* heap) { free(heap->items); }
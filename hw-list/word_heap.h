@@ -0,0 +1,43 @@
+/*
+ * The word_heap interface keeps the K greatest of a stream of word count
+ * entries in a bounded min-heap, so selecting them costs O(n log K) instead
+ * of a full sort.
+ */
+
+#ifndef WORD_HEAP_H
+#define WORD_HEAP_H
+
+#include "word_count.h"
+
+typedef struct word_heap {
+  word_count_t** items;
+  size_t len;
+  size_t k;
+  bool (*less)(const word_count_t*, const word_count_t*);
+} word_heap_t;
+
+/*
+ * Initialize an empty heap that keeps the K greatest entries under LESS. Room
+ * for K entries is allocated up front, so callers should not ask for more
+ * than they can offer. Returns -1 if that allocation fails.
+ */
+int word_heap_init(word_heap_t* heap, size_t k,
+                    bool less(const word_count_t*, const word_count_t*));
+
+/*
+ * Offer an entry to the heap. Returns the entry that is not kept, which is
+ * either WC or a previously kept entry it displaced, or NULL if the heap was
+ * not full yet.
+ */
+word_count_t* word_heap_offer(word_heap_t* heap, word_count_t* wc);
+
+/*
+ * Sort the kept entries in ascending order and return them. The heap holds
+ * heap->len entries and must not be offered more afterwards.
+ */
+word_count_t** word_heap_sort(word_heap_t* heap);
+
+/* Free the heap, but not the entries. */
+void word_heap_destroy(word_heap_t* heap);
+
+#endif /* WORD_HEAP_H */
@@ -0,0 +1,378 @@
+/*
+ * Binary snapshots of word count lists, see word_snapshot.h for the format.
+ */
+
+#include <errno.h>
+#include <limits.h>
+#include <stdbool.h>
+#include <stdlib.h>
+#include <string.h>
+
+#include "word_helpers.h"
+#include "word_snapshot.h"
+
+#define SNAPSHOT_MAGIC "WCNT"
+#define SNAPSHOT_VERSION 1
+#define HEADER_SIZE 32
+
+#define FNV_OFFSET 2166136261u
+#define FNV_PRIME 16777619u
+
+static uint32_t fnv1a(uint32_t h, const unsigned char* buf, size_t len) {
+  for (size_t i = 0; i < len; i++) {
+    h ^= buf[i];
+    h *= FNV_PRIME;
+  }
+  return h;
+}
+
+static void put_u32(unsigned char* p, uint32_t v) {
+  for (int i = 0; i < 4; i++)
+    p[i] = v >> (8 * i);
+}
+
+static void put_u64(unsigned char* p, uint64_t v) {
+  for (int i = 0; i < 8; i++)
+    p[i] = v >> (8 * i);
+}
+
+static uint32_t get_u32(const unsigned char* p) {
+  uint32_t v = 0;
+  for (int i = 0; i < 4; i++)
+    v |= (uint32_t)p[i] << (8 * i);
+  return v;
+}
+
+static uint64_t get_u64(const unsigned char* p) {
+  uint64_t v = 0;
+  for (int i = 0; i < 8; i++)
+    v |= (uint64_t)p[i] << (8 * i);
+  return v;
+}
+
+/* Orders words like strcmp, for words of explicit length. */
+static int compare_words(const char* a, size_t alen, const char* b, size_t blen) {
+  int c = memcmp(a, b, alen < blen ? alen : blen);
+  if (c != 0)
+    return c;
+  return alen < blen ? -1 : alen > blen;
+}
+
+static int write_body(snapshot_writer_t* w, const void* buf, size_t len) {
+  if (fwrite(buf, 1, len, w->file) != len) {
+    w->error = errno ? errno : EIO;
+    return -1;
+  }
+
+  w->checksum = fnv1a(w->checksum, buf, len);
+  w->body_size += len;
+  return 0;
+}
+
+static int write_varint(snapshot_writer_t* w, uint64_t v) {
+  unsigned char buf[10];
+  size_t n = 0;
+
+  do {
+    buf[n] = v & 0x7f;
+    v >>= 7;
+    if (v)
+      buf[n] |= 0x80;
+    n++;
+  } while (v);
+
+  return write_body(w, buf, n);
+}
+
+int snapshot_create(snapshot_writer_t* w, const char* path) {
+  unsigned char header[HEADER_SIZE] = {0};
+
+  memset(w, 0, sizeof(snapshot_writer_t));
+  w->checksum = FNV_OFFSET;
+  w->path = strdup(path);
+  w->tmp_path = malloc(strlen(path) + sizeof(".tmp"));
+  sprintf(w->tmp_path, "%s.tmp", path);
+
+  w->file = fopen(w->tmp_path, "wb");
+  if (w->file == NULL) {
+    free(w->path);
+    free(w->tmp_path);
+    return -1;
+  }
+
+  /* filled in by snapshot_finish */
+  if (fwrite(header, 1, HEADER_SIZE, w->file) != HEADER_SIZE)
+    w->error = errno;
+  return 0;
+}
+
+int snapshot_write(snapshot_writer_t* w, const char* word, size_t len, uint64_t count) {
+  if (w->error)
+    return -1;
+
+  size_t shared = 0;
+  size_t max = len < w->prev_len ? len : w->prev_len;
+  while (shared < max && word[shared] == w->prev[shared])
+    shared++;
+
+  if (w->num_words > 0 && compare_words(word, len, w->prev, w->prev_len) <= 0) {
+    w->error = EINVAL;
+    return -1;
+  }
+
+  if (write_varint(w, shared) || write_varint(w, len - shared) ||
+      write_body(w, word + shared, len - shared) || write_varint(w, count))
+    return -1;
+
+  if (len > w->prev_cap) {
+    w->prev_cap = len > 2 * w->prev_cap ? len : 2 * w->prev_cap;
+    w->prev = realloc(w->prev, w->prev_cap);
+  }
+  memcpy(w->prev + shared, word + shared, len - shared);
+  w->prev_len = len;
+  w->num_words++;
+  return 0;
+}
+
+int snapshot_finish(snapshot_writer_t* w) {
+  unsigned char header[HEADER_SIZE] = {0};
+
+  memcpy(header, SNAPSHOT_MAGIC, 4);
+  put_u32(header + 4, SNAPSHOT_VERSION);
+  put_u64(header + 8, w->num_words);
+  put_u64(header + 16, w->body_size);
+  put_u32(header + 24, w->checksum);
+
+  if (!w->error &&
+      (fseek(w->file, 0, SEEK_SET) != 0 || fwrite(header, 1, HEADER_SIZE, w->file) != HEADER_SIZE))
+    w->error = errno;
+  if (fclose(w->file) != 0 && !w->error)
+    w->error = errno;
+  if (!w->error && rename(w->tmp_path, w->path) != 0)
+    w->error = errno;
+  if (w->error)
+    remove(w->tmp_path);
+
+  free(w->path);
+  free(w->tmp_path);
+  free(w->prev);
+
+  errno = w->error;
+  return w->error ? -1 : 0;
+}
+
+static int read_body(snapshot_reader_t* r, void* buf, size_t len) {
+  if (len > r->body_left) {
+    errno = EINVAL;
+    return -1;
+  }
+
+  if (fread(buf, 1, len, r->file) != len) {
+    if (!ferror(r->file))
+      errno = EINVAL;
+    return -1;
+  }
+
+  r->checksum = fnv1a(r->checksum, buf, len);
+  r->body_left -= len;
+  return 0;
+}
+
+static int read_varint(snapshot_reader_t* r, uint64_t* v) {
+  *v = 0;
+
+  for (int shift = 0; shift < 64; shift += 7) {
+    int b = r->body_left > 0 ? getc(r->file) : EOF;
+    if (b == EOF) {
+      if (!ferror(r->file))
+        errno = EINVAL;
+      return -1;
+    }
+
+    r->checksum = (r->checksum ^ b) * FNV_PRIME;
+    r->body_left--;
+    *v |= (uint64_t)(b & 0x7f) << shift;
+    if (!(b & 0x80))
+      return 0;
+  }
+
+  errno = EINVAL;
+  return -1;
+}
+
+int snapshot_open(snapshot_reader_t* r, const char* path) {
+  unsigned char header[HEADER_SIZE];
+
+  memset(r, 0, sizeof(snapshot_reader_t));
+  r->file = fopen(path, "rb");
+  if (r->file == NULL)
+    return -1;
+
+  if (fread(header, 1, HEADER_SIZE, r->file) != HEADER_SIZE ||
+      memcmp(header, SNAPSHOT_MAGIC, 4) != 0 || get_u32(header + 4) != SNAPSHOT_VERSION) {
+    fclose(r->file);
+    errno = EINVAL;
+    return -1;
+  }
+
+  r->words_left = get_u64(header + 8);
+  r->body_left = get_u64(header + 16);
+  r->expected = get_u32(header + 24);
+  r->checksum = FNV_OFFSET;
+  r->cap = 64;
+  r->word = malloc(r->cap);
+  r->word[0] = '\0';
+  return 0;
+}
+
+int snapshot_next(snapshot_reader_t* r) {
+  uint64_t shared, suffix;
+
+  if (r->words_left == 0) {
+    if (r->body_left != 0 || r->checksum != r->expected) {
+      errno = EINVAL;
+      return -1;
+    }
+    return 0;
+  }
+
+  if (read_varint(r, &shared) || read_varint(r, &suffix))
+    return -1;
+  if (shared > r->len || suffix > r->body_left) {
+    errno = EINVAL;
+    return -1;
+  }
+
+  size_t len = shared + suffix;
+  if (len + 1 > r->cap) {
+    r->cap = len + 1 > 2 * r->cap ? len + 1 : 2 * r->cap;
+    r->word = realloc(r->word, r->cap);
+  }
+
+  if (read_body(r, r->word + shared, suffix) || read_varint(r, &r->count))
+    return -1;
+
+  r->word[len] = '\0';
+  r->len = len;
+  r->words_left--;
+  return 1;
+}
+
+void snapshot_close(snapshot_reader_t* r) {
+  int saved = errno;
+
+  fclose(r->file);
+  free(r->word);
+  errno = saved;
+}
+
+static void save_word(word_count_t* wc, void* aux) {
+  snapshot_write(aux, wc->word, strlen(wc->word), wc->count);
+}
+
+int save_words(word_count_list_t* wclist, const char* path) {
+  snapshot_writer_t w;
+
+  if (snapshot_create(&w, path) != 0)
+    return -1;
+
+  wordcount_sort(wclist, less_word);
+  foreach_word(wclist, save_word, &w);
+  return snapshot_finish(&w);
+}
+
+int load_words(word_count_list_t* wclist, const char* path) {
+  snapshot_reader_t r;
+  int ret;
+
+  if (snapshot_open(&r, path) != 0)
+    return -1;
+
+  while ((ret = snapshot_next(&r)) == 1) {
+    if (r.count == 0) {
+      errno = EINVAL;
+      ret = -1;
+      break;
+    }
+    if (r.count > INT_MAX) {
+      errno = EOVERFLOW;
+      ret = -1;
+      break;
+    }
+
+    word_count_t* wc = add_word_n(wclist, r.word, r.len);
+    if (r.count - 1 > (uint64_t)(INT_MAX - wc->count)) {
+      errno = EOVERFLOW;
+      ret = -1;
+      break;
+    }
+    wc->count += r.count - 1;
+  }
+
+  snapshot_close(&r);
+  return ret;
+}
+
+int merge_snapshots(const char* out, char* const paths[], int n) {
+  snapshot_reader_t* readers = calloc(n, sizeof(snapshot_reader_t));
+  int* state = calloc(n, sizeof(int)); // snapshot_next() result per reader
+  snapshot_writer_t w;
+  int opened = 0;
+  int ret = -1;
+
+  for (; opened < n; opened++) {
+    if (snapshot_open(&readers[opened], paths[opened]) != 0)
+      goto done;
+  }
+
+  if (snapshot_create(&w, out) != 0)
+    goto done;
+
+  for (int i = 0; i < n && !w.error; i++) {
+    state[i] = snapshot_next(&readers[i]);
+    if (state[i] < 0)
+      w.error = errno ? errno : EINVAL;
+  }
+
+  while (!w.error) {
+    snapshot_reader_t* min = NULL;
+    uint64_t count = 0;
+
+    for (int i = 0; i < n; i++) {
+      snapshot_reader_t* r = &readers[i];
+      if (state[i] != 1)
+        continue;
+
+      int c = min ? compare_words(r->word, r->len, min->word, min->len) : -1;
+      if (c < 0) {
+        min = r;
+        count = r->count;
+      } else if (c == 0) {
+        count += r->count;
+      }
+    }
+
+    if (min == NULL || snapshot_write(&w, min->word, min->len, count) != 0)
+      break;
+
+    /* advance every reader that was at the word just written */
+    for (int i = 0; i < n && !w.error; i++) {
+      snapshot_reader_t* r = &readers[i];
+      if (state[i] != 1 || compare_words(r->word, r->len, w.prev, w.prev_len) != 0)
+        continue;
+
+      state[i] = snapshot_next(r);
+      if (state[i] < 0)
+        w.error = errno ? errno : EINVAL;
+    }
+  }
+
+  ret = snapshot_finish(&w);
+
+done:
+  for (int i = 0; i < opened; i++)
+    snapshot_close(&readers[i]);
+  free(readers);
+  free(state);
+  return ret;
+}
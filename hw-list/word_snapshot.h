@@ -0,0 +1,96 @@
+#ifndef WORD_SNAPSHOT_H
+#define WORD_SNAPSHOT_H
+
+#include <stdint.h>
+#include <stdio.h>
+
+#include "word_count.h"
+
+/*
+ * A snapshot is a word count list on disk, sorted by word so that snapshots
+ * can be merged in one streaming pass.
+ *
+ * All integers are little-endian. The header is
+ *
+ *   magic "WCNT", u32 version, u64 number of words, u64 body size,
+ *   u32 FNV-1a checksum of the body, u32 reserved
+ *
+ * and the body holds one record per word, each front coded against the word
+ * before it:
+ *
+ *   varint shared prefix length, varint suffix length, suffix, varint count
+ *
+ * Functions returning int return 0 on success and -1 with errno set on
+ * failure. A corrupt snapshot fails with EINVAL.
+ */
+
+typedef struct snapshot_writer {
+  FILE* file;
+  char* path;
+  char* tmp_path;
+  char* prev; // Last word written.
+  size_t prev_len;
+  size_t prev_cap;
+  uint64_t num_words;
+  uint64_t body_size;
+  uint32_t checksum;
+  int error; // errno of the first failure, 0 if none.
+} snapshot_writer_t;
+
+typedef struct snapshot_reader {
+  FILE* file;
+  char* word; // Current word, NUL-terminated.
+  size_t len;
+  size_t cap;
+  uint64_t count;
+  uint64_t words_left;
+  uint64_t body_left;
+  uint32_t checksum;
+  uint32_t expected;
+} snapshot_reader_t;
+
+/*
+ * Starts writing a snapshot to PATH. The data goes to a temporary file that
+ * only replaces PATH in snapshot_finish, so an interrupted checkpoint never
+ * leaves a truncated snapshot behind.
+ */
+int snapshot_create(snapshot_writer_t* w, const char* path);
+
+/* Appends WORD of LEN bytes, which must sort after the previous word. */
+int snapshot_write(snapshot_writer_t* w, const char* word, size_t len, uint64_t count);
+
+/* Completes the header and moves the snapshot into place. Always frees W. */
+int snapshot_finish(snapshot_writer_t* w);
+
+/* Opens the snapshot at PATH and checks its header. */
+int snapshot_open(snapshot_reader_t* r, const char* path);
+
+/*
+ * Reads the next record into R->word, R->len and R->count. Returns 1 for a
+ * record, 0 at the end of a snapshot whose checksum matched and -1 on error.
+ */
+int snapshot_next(snapshot_reader_t* r);
+
+void snapshot_close(snapshot_reader_t* r);
+
+/*
+ * Writes WCLIST to PATH. Snapshots are sorted by word, so this sorts WCLIST
+ * by word in place with wordcount_sort; callers that need another order have
+ * to sort it again afterwards.
+ */
+int save_words(word_count_list_t* wclist, const char* path);
+
+/*
+ * Adds the counts in the snapshot at PATH to WCLIST. Fails with EOVERFLOW if
+ * a count, or its sum with the count already in WCLIST, does not fit the
+ * list's int counts. On error WCLIST may hold part of the snapshot.
+ */
+int load_words(word_count_list_t* wclist, const char* path);
+
+/*
+ * Merges the N snapshots at PATHS into a new snapshot at OUT, adding up the
+ * counts of common words, without loading any of them into memory.
+ */
+int merge_snapshots(const char* out, char* const paths[], int n);
+
+#endif /* WORD_SNAPSHOT_H */
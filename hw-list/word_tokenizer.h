@@ -0,0 +1,24 @@
+/*
+ * The word_tokenizer interface splits a buffer into runs of letters, folded
+ * to lower case.
+ *
+ * The input is classified and folded to lower case 64 bytes at a time with
+ * SSE2 (or AVX2 when built with -mavx2). Words are passed on as slices of
+ * that buffer instead of being copied one by one.
+ */
+
+#ifndef WORD_TOKENIZER_H
+#define WORD_TOKENIZER_H
+
+#include <stddef.h>
+
+/* Receives a run of letters, folded to lower case and not NUL-terminated. */
+typedef void word_emit_func(const char* word, size_t len, void* aux);
+
+/*
+ * Calls EMIT for every run of letters in the LEN bytes at BUF. The slice is
+ * only valid during the call.
+ */
+void tokenize_words(const char* buf, size_t len, word_emit_func* emit, void* aux);
+
+#endif /* WORD_TOKENIZER_H */
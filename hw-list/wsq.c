@@ -0,0 +1,62 @@
+#include <stdlib.h>
+#include <string.h>
+
+#include "wsq.h"
+
+#define WSQ_INITIAL_CAP 16
+
+/* Initializes an empty deque WSQ. */
+void wsq_init(wsq_t* wsq) {
+  pthread_mutex_init(&wsq->mutex, NULL);
+  wsq->items = malloc(WSQ_INITIAL_CAP * sizeof(void*));
+  wsq->head = 0;
+  wsq->tail = 0;
+  wsq->cap = WSQ_INITIAL_CAP;
+}
+
+/* Frees WSQ, but not the items still in it. */
+void wsq_destroy(wsq_t* wsq) {
+  pthread_mutex_destroy(&wsq->mutex);
+  free(wsq->items);
+}
+
+/* Adds ITEM at the bottom of WSQ. */
+void wsq_push(wsq_t* wsq, void* item) {
+  pthread_mutex_lock(&wsq->mutex);
+  if (wsq->tail == wsq->cap) {
+    if (wsq->head > 0) {
+      memmove(wsq->items, wsq->items + wsq->head, (wsq->tail - wsq->head) * sizeof(void*));
+      wsq->tail -= wsq->head;
+      wsq->head = 0;
+    } else {
+      wsq->cap *= 2;
+      wsq->items = realloc(wsq->items, wsq->cap * sizeof(void*));
+    }
+  }
+  wsq->items[wsq->tail++] = item;
+  pthread_mutex_unlock(&wsq->mutex);
+}
+
+/* Removes the bottom item of WSQ. Returns NULL if WSQ is empty. */
+void* wsq_pop(wsq_t* wsq) {
+  void* item = NULL;
+
+  pthread_mutex_lock(&wsq->mutex);
+  if (wsq->tail > wsq->head)
+    item = wsq->items[--wsq->tail];
+  pthread_mutex_unlock(&wsq->mutex);
+
+  return item;
+}
+
+/* Removes the top item of WSQ. Returns NULL if WSQ is empty. */
+void* wsq_steal(wsq_t* wsq) {
+  void* item = NULL;
+
+  pthread_mutex_lock(&wsq->mutex);
+  if (wsq->tail > wsq->head)
+    item = wsq->items[wsq->head++];
+  pthread_mutex_unlock(&wsq->mutex);
+
+  return item;
+}
@@ -0,0 +1,26 @@
+#ifndef WSQ_H
+#define WSQ_H
+
+#include <pthread.h>
+
+/*
+ * WSQ defines a work-stealing deque. The owning thread pushes and pops items
+ * at the bottom, so it works through its own items last-in first-out, while
+ * other threads steal from the top, taking the oldest items first.
+ */
+
+typedef struct wsq {
+  void** items;
+  int head; // Next item to be stolen.
+  int tail; // One past the owner's next item.
+  int cap;
+  pthread_mutex_t mutex;
+} wsq_t;
+
+void wsq_init(wsq_t* wsq);
+void wsq_destroy(wsq_t* wsq);
+void wsq_push(wsq_t* wsq, void* item);
+void* wsq_pop(wsq_t* wsq);
+void* wsq_steal(wsq_t* wsq);
+
+#endif /* WSQ_H */
@@ -4,119 +4,396 @@
 
 #include "mm_alloc.h"
 
+#include <stdint.h>
 #include <stdlib.h>
 #include <unistd.h>
 #include <stdio.h>
 #include <string.h>
 
-struct block {
-  struct block* prev;
-  struct block* next;
-  char free;
-  size_t size;
+/*
+ * Heap layout
+ *
+ * Every block starts with an 8-byte header holding the block size (header
+ * included, always a multiple of ALIGNMENT) and two flag bits. Headers sit at
+ * addresses that are 8 mod 16, so payloads are 16-byte aligned.
+ *
+ *   allocated: [header][payload ..................]
+ *   free:      [header][next][prev] ...... [footer]
+ *
+ * Only free blocks carry a footer (a copy of the size), which is what lets
+ * mm_free find and merge the previous block. The PREV_ALLOC bit tells whether
+ * that footer exists. Free blocks are also linked into a doubly linked free
+ * list through their first two payload words.
+ *
+ * The heap ends with a zero-sized allocated header, the epilogue.
+ *
+ * If something else moved the break between two calls to sbrk, the memory in
+ * between is covered by an allocated block flagged FOREIGN, which is never
+ * freed and is left out of the statistics.
+ */
+
+#define ALIGNMENT 16
+#define HEADER_SIZE sizeof(size_t)
+#define MIN_BLOCK_SIZE (HEADER_SIZE + sizeof(struct free_block) + HEADER_SIZE)
+
+#define ALLOC 0x1
+#define PREV_ALLOC 0x2
+#define FOREIGN 0x4
+#define FLAGS (ALLOC | PREV_ALLOC | FOREIGN)
+
+typedef size_t header_t;
+
+/* Payload of a free block */
+struct free_block {
+  struct free_block* next;
+  struct free_block* prev;
 };
 
-static struct block* list = NULL;
+static header_t* heap_start = NULL;
+static header_t* epilogue = NULL;
+static struct free_block* free_list = NULL;
 
-void* mm_malloc(size_t size) {
-  if (size == 0) {
+/* Total number of bytes requested from sbrk */
+static size_t heap_size = 0;
+
+/* Sampling state, see mm_set_sample_interval() */
+static size_t sample_interval = 0;
+static size_t sample_seq = 0;
+static size_t samples_len = 0;
+static struct mm_sample samples[MM_MAX_SAMPLES];
+
+static size_t block_size(header_t* h) { return *h & ~(size_t) FLAGS; }
+
+static header_t* next_block(header_t* h) { return (header_t*) ((char*) h + block_size(h)); }
+
+static void* payload(header_t* h) { return (char*) h + HEADER_SIZE; }
+
+static header_t* header(void* ptr) { return (header_t*) ((char*) ptr - HEADER_SIZE); }
+
+static void set_footer(header_t* h) { *(header_t*) ((char*) next_block(h) - HEADER_SIZE) = block_size(h); }
+
+/* Previous block, only valid when H does not have PREV_ALLOC set */
+static header_t* prev_block(header_t* h) { return (header_t*) ((char*) h - *(h - 1)); }
+
+static void free_list_insert(header_t* h) {
+  struct free_block* b = payload(h);
+  b->prev = NULL;
+  b->next = free_list;
+  if (free_list)
+    free_list->prev = b;
+  free_list = b;
+}
+
+static void free_list_remove(header_t* h) {
+  struct free_block* b = payload(h);
+  if (b->prev)
+    b->prev->next = b->next;
+  else
+    free_list = b->next;
+  if (b->next)
+    b->next->prev = b->prev;
+}
+
+static void* grow_heap(size_t size) {
+  void* p = sbrk(size);
+  if ((char *) p != (char *) -1)
+    heap_size += size;
+  return p;
+}
+
+static int init_heap() {
+  char* brk = grow_heap(0);
+  if (brk == (char *) -1)
+    return -1;
+
+  /* pad so that the epilogue (the first block header) is at 8 mod 16 */
+  size_t pad = (ALIGNMENT - ((uintptr_t) brk + HEADER_SIZE) % ALIGNMENT) % ALIGNMENT;
+  brk = grow_heap(pad + HEADER_SIZE);
+  if (brk == (char *) -1)
+    return -1;
+
+  heap_start = epilogue = (header_t*) (brk + pad);
+  *epilogue = ALLOC | PREV_ALLOC;
+  return 0;
+}
+
+/* Merges free block H with free neighbours, which must not be on the free list yet */
+static header_t* coalesce(header_t* h) {
+  header_t* next = next_block(h);
+
+  if (!(*next & ALLOC)) {
+    free_list_remove(next);
+    *h += block_size(next);
+  }
+
+  if (!(*h & PREV_ALLOC)) {
+    header_t* prev = prev_block(h);
+    free_list_remove(prev);
+    *prev += block_size(h);
+    h = prev;
+  }
+
+  set_footer(h);
+  *next_block(h) &= ~(size_t) PREV_ALLOC;
+  return h;
+}
+
+/* Grows the heap until it ends with a free block of at least SIZE bytes and returns that block */
+static header_t* extend_heap(size_t size) {
+  // a free block at the end of the heap only needs to be topped up
+  size_t tail = 0;
+  if (!(*epilogue & PREV_ALLOC))
+    tail = block_size(prev_block(epilogue));
+
+  char* end = (char*) epilogue + HEADER_SIZE;
+  char* brk = grow_heap(size - tail);
+  if (brk == (char *) -1)
     return NULL;
+
+  header_t* h = epilogue;
+  if (brk == end) {
+    *h = (size - tail) | (*h & PREV_ALLOC);
+    epilogue = next_block(h);
+    *epilogue = ALLOC;
+
+    h = coalesce(h);
+    free_list_insert(h);
+    return h;
   }
 
-  struct block* p = list;
+  // the break was moved behind our back, so start over past the foreign memory
+  if (brk < end)
+    return NULL;
 
-  // if no blocks yet
-  if (p == NULL) {
-    list = p = sbrk(sizeof(struct block) + size);
-    if ((char *) list == (char *) -1)
-      return NULL;
+  size_t pad = (ALIGNMENT - ((uintptr_t) brk + HEADER_SIZE) % ALIGNMENT) % ALIGNMENT;
+  if (grow_heap(pad + HEADER_SIZE + tail) != brk + size - tail)
+    return NULL;
+
+  header_t* gap = epilogue;
+  h = (header_t*) (brk + pad);
+  *gap = ((char*) h - (char*) gap) | ALLOC | FOREIGN | (*gap & PREV_ALLOC);
+  *h = size | PREV_ALLOC;
+  epilogue = next_block(h);
+  *epilogue = ALLOC;
+
+  set_footer(h);
+  free_list_insert(h);
+  return h;
+}
+
+/* Marks free block H as allocated with SIZE bytes, returning the rest to the free list */
+static void place(header_t* h, size_t size) {
+  size_t total = block_size(h);
+  free_list_remove(h);
 
-    p->size = size;
-    p->free = 0;
-    p->prev = NULL;
-    p->next = NULL;
-    return p + sizeof(struct block);
+  if (total - size >= MIN_BLOCK_SIZE) {
+    *h = size | ALLOC | (*h & PREV_ALLOC);
+    header_t* rest = next_block(h);
+    *rest = (total - size) | PREV_ALLOC;
+    set_footer(rest);
+    free_list_insert(rest);
+  } else {
+    *h |= ALLOC;
+    *next_block(h) |= PREV_ALLOC;
   }
+}
 
-  // find a free block that would fit or the last one
-  while (p->next) {
-    if (p->free && p->size >= size) {
-      break;
-    }
-    p = p->next;
+/* Block size needed to hold SIZE payload bytes, 0 on overflow */
+static size_t adjust_size(size_t size) {
+  if (size > SIZE_MAX - HEADER_SIZE - ALIGNMENT)
+    return 0;
+
+  size = (size + HEADER_SIZE + ALIGNMENT - 1) & ~(size_t) (ALIGNMENT - 1);
+  return size < MIN_BLOCK_SIZE ? MIN_BLOCK_SIZE : size;
+}
+
+static void* alloc_block(size_t size) {
+  if (size == 0) {
+    return NULL;
   }
 
-  // if free no block, allocate a new one
-  if (!(p->free && p->size >= size)) {
-    struct block* next_p = sbrk(sizeof(struct block) + size);
-    if ((char *) next_p == (char *) -1)
-      return NULL;
+  size_t asize = adjust_size(size);
+  if (asize == 0)
+    return NULL;
 
-    p->next = next_p;
+  if (heap_start == NULL && init_heap() == -1)
+    return NULL;
 
-    next_p->prev = p;
-    next_p->next = NULL;
-    next_p->free = 0;
-    next_p->size = size;
+  // first fit on the free list
+  struct free_block* b;
+  for (b = free_list; b; b = b->next) {
+    if (block_size(header(b)) >= asize)
+      break;
+  }
 
-    return next_p + sizeof(struct block);
+  header_t* h;
+  if (b) {
+    h = header(b);
+  } else {
+    h = extend_heap(asize);
+    if (h == NULL)
+      return NULL;
   }
 
-  // if the free block has bigger size and can contain another block, than split it in two
-  // otherwise just return it as it is
-  if (p->size - (size + sizeof(struct block)) > sizeof(struct block)) {
-    struct block* next_p = p + sizeof(struct block) + size;
-    next_p->free = 1;
-    next_p->prev = p;
-    next_p->next = p->next;
-    next_p->size = p->size - (size + sizeof(struct block));
+  place(h, asize);
+  return payload(h);
+}
+
+/* Counts an allocation of SIZE bytes at PTR made from CALLER, recording it if it is sampled */
+static void sample(void* ptr, size_t size, void* caller) {
+  if (ptr == NULL || sample_interval == 0)
+    return;
 
-    p->free = 0;
-    p->size = size;
-    p->next = next_p;
-    return p + sizeof(struct block);
-  } else {
-    p->free = 0;
-    return p + sizeof(struct block);
+  if (sample_seq++ % sample_interval == 0) {
+    struct mm_sample* s = &samples[samples_len % MM_MAX_SAMPLES];
+    s->caller = caller;
+    s->ptr = ptr;
+    s->size = size;
+    s->seq = sample_seq - 1;
+    s->live = 1;
+    samples_len++;
   }
 }
 
+void* mm_malloc(size_t size) {
+  void* ptr = alloc_block(size);
+  sample(ptr, size, __builtin_return_address(0));
+  return ptr;
+}
+
 void* mm_realloc(void* ptr, size_t size) {
-  if (list == NULL)
-    return NULL;
-  if (ptr == NULL)
-    return mm_malloc(size);
+  if (ptr == NULL) {
+    void* new_ptr = alloc_block(size);
+    sample(new_ptr, size, __builtin_return_address(0));
+    return new_ptr;
+  }
   if (size == 0) {
     mm_free(ptr);
     return NULL;
   }
 
-  struct block* p = ptr - sizeof(struct block);
+  size_t asize = adjust_size(size);
+  if (asize == 0)
+    return NULL;
+
+  header_t* h = header(ptr);
+  if (block_size(h) >= asize)
+    return ptr;
 
-  if (p->size >= size) return ptr;
+  // grow in place into a free successor
+  header_t* next = next_block(h);
+  if (!(*next & ALLOC) && block_size(h) + block_size(next) >= asize) {
+    free_list_remove(next);
+    *h += block_size(next);
+    *next_block(h) |= PREV_ALLOC;
+    return ptr;
+  }
 
-  struct block* next_p = sbrk(sizeof(struct block) + size);
-  if ((char *) next_p == (char *) -1)
+  void* new_ptr = alloc_block(size);
+  if (new_ptr == NULL)
     return NULL;
+  sample(new_ptr, size, __builtin_return_address(0));
+
+  memcpy(new_ptr, ptr, block_size(h) - HEADER_SIZE);
+  mm_free(ptr);
+  return new_ptr;
+}
 
-  p->free = 1;
+void mm_free(void* ptr) {
+  if (heap_start == NULL || ptr == NULL)
+    return;
 
-  while (p->next) {
-    p = p->next;
+  header_t* h = header(ptr);
+  *h &= ~(size_t) ALLOC;
+  free_list_insert(coalesce(h));
+
+  if (sample_interval) {
+    for (size_t i = 0; i < samples_len && i < MM_MAX_SAMPLES; i++) {
+      if (samples[i].ptr == ptr)
+        samples[i].live = 0;
+    }
   }
+}
 
-  next_p->prev = p;
-  next_p->next = NULL;
-  next_p->free = 0;
-  next_p->size = size;
+static int size_class(size_t size) {
+  int class = 0;
 
-  return next_p + sizeof(struct block);
+  for (size >>= 5; size && class < MM_SIZE_CLASSES - 1; size >>= 1)
+    class++;
+
+  return class;
 }
 
-void mm_free(void* ptr) {
-  if (list == NULL || ptr == NULL)
+void mm_stats(struct mm_stats* stats) {
+  memset(stats, 0, sizeof(struct mm_stats));
+  stats->sbrk_total = heap_size;
+
+  if (heap_start == NULL)
     return;
 
-  struct block* p = ptr - sizeof(struct block);
-  p->free = 1;
+  for (header_t* h = heap_start; h != epilogue; h = next_block(h)) {
+    size_t size = block_size(h) - HEADER_SIZE;
+
+    if (*h & FOREIGN) {
+      continue;
+    } else if (*h & ALLOC) {
+      stats->live_bytes += size;
+      stats->used_blocks++;
+    } else {
+      stats->free_bytes += size;
+      stats->free_bytes_by_class[size_class(size)] += size;
+      stats->free_blocks++;
+      if (size > stats->largest_free)
+        stats->largest_free = size;
+    }
+  }
+}
+
+void mm_set_sample_interval(size_t n) {
+  sample_interval = n;
+  sample_seq = 0;
+  samples_len = 0;
+}
+
+size_t mm_get_samples(struct mm_sample* out, size_t max) {
+  size_t n = samples_len < MM_MAX_SAMPLES ? samples_len : MM_MAX_SAMPLES;
+  size_t first = samples_len - n;
+
+  if (n > max) {
+    first += n - max;
+    n = max;
+  }
+
+  for (size_t i = 0; i < n; i++)
+    out[i] = samples[(first + i) % MM_MAX_SAMPLES];
+
+  return n;
+}
+
+void mm_dump_heap(FILE* out) {
+  struct mm_stats stats;
+  struct mm_sample live[MM_MAX_SAMPLES];
+
+  fprintf(out, "heap dump:\n");
+  for (header_t* h = heap_start; h && h != epilogue; h = next_block(h))
+    fprintf(out, "  %p %10zu %s\n", payload(h), block_size(h) - HEADER_SIZE,
+            *h & FOREIGN ? "foreign" : *h & ALLOC ? "used" : "free");
+
+  mm_stats(&stats);
+  fprintf(out, "live: %zu bytes in %zu blocks\n", stats.live_bytes, stats.used_blocks);
+  fprintf(out, "free: %zu bytes in %zu blocks, largest %zu\n", stats.free_bytes,
+          stats.free_blocks, stats.largest_free);
+  for (int i = 0; i < MM_SIZE_CLASSES; i++) {
+    if (stats.free_bytes_by_class[i])
+      fprintf(out, "  class %2d (>= %zu): %zu bytes\n", i, i ? (size_t) 16 << i : 0,
+              stats.free_bytes_by_class[i]);
+  }
+  fprintf(out, "sbrk: %zu bytes\n", stats.sbrk_total);
+
+  size_t n = mm_get_samples(live, MM_MAX_SAMPLES);
+  for (size_t i = 0; i < n; i++) {
+    if (live[i].live)
+      fprintf(out, "sample #%zu: %zu bytes at %p from %p\n", live[i].seq, live[i].size,
+              live[i].ptr, live[i].caller);
+  }
 }
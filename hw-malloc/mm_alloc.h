@@ -9,10 +9,60 @@
 #ifndef _malloc_H_
 #define _malloc_H_
 
+#include <stdio.h>
 #include <stdlib.h>
 
 void* mm_malloc(size_t size);
 void* mm_realloc(void* ptr, size_t size);
 void mm_free(void* ptr);
 
+/*
+ * Heap statistics.
+ *
+ * Free bytes are bucketed into power-of-two size classes: class 0 holds
+ * blocks smaller than 32 bytes, class i holds blocks of [2^(i+4), 2^(i+5))
+ * bytes and the last class holds everything larger.
+ */
+#define MM_SIZE_CLASSES 16
+
+struct mm_stats {
+  size_t live_bytes;                            /* payload bytes in use */
+  size_t free_bytes;                            /* payload bytes in free blocks */
+  size_t free_bytes_by_class[MM_SIZE_CLASSES];  /* free_bytes split by size class */
+  size_t used_blocks;                           /* number of allocated blocks */
+  size_t free_blocks;                           /* number of free blocks */
+  size_t largest_free;                          /* payload size of the largest free block */
+  size_t sbrk_total;                            /* bytes obtained from sbrk so far */
+};
+
+/* Fills STATS with a snapshot of the heap. */
+void mm_stats(struct mm_stats* stats);
+
+/* Prints every block, the statistics and the live samples to OUT. */
+void mm_dump_heap(FILE* out);
+
+/*
+ * Allocation sampling.
+ *
+ * When enabled, the call site of every Nth successful allocation (mm_malloc,
+ * or mm_realloc when it returns a new block) is recorded
+ * in a ring of the last MM_MAX_SAMPLES samples. Samples whose block was
+ * freed since are kept but marked as not live.
+ */
+#define MM_MAX_SAMPLES 64
+
+struct mm_sample {
+  void* caller;  /* return address of the mm_malloc or mm_realloc call */
+  void* ptr;     /* pointer that was returned */
+  size_t size;   /* requested size */
+  size_t seq;    /* index of the allocation since sampling was enabled */
+  int live;      /* 0 once the block has been freed */
+};
+
+/* Records every Nth allocation; 0 disables sampling and drops old samples. */
+void mm_set_sample_interval(size_t n);
+
+/* Copies up to MAX samples, oldest first, into SAMPLES and returns the count. */
+size_t mm_get_samples(struct mm_sample* samples, size_t max);
+
 #endif
@@ -1,12 +1,17 @@
 #include <assert.h>
 #include <dlfcn.h>
 #include <stdio.h>
+#include <stdint.h>
 #include <stdlib.h>
+#include <string.h>
+#include <unistd.h>
 
 /* Function pointers to hw3 functions */
 void* (*mm_malloc)(size_t);
 void* (*mm_realloc)(void*, size_t);
 void (*mm_free)(void*);
+void (*mm_dump_heap)(FILE*);
+void (*mm_set_sample_interval)(size_t);
 
 static void* try_dlsym(void* handle, const char* symbol) {
   char* error;
@@ -28,14 +33,44 @@ static void load_alloc_functions() {
   mm_malloc = try_dlsym(handle, "mm_malloc");
   mm_realloc = try_dlsym(handle, "mm_realloc");
   mm_free = try_dlsym(handle, "mm_free");
+  mm_dump_heap = try_dlsym(handle, "mm_dump_heap");
+  mm_set_sample_interval = try_dlsym(handle, "mm_set_sample_interval");
 }
 
 int main() {
   load_alloc_functions();
+  mm_set_sample_interval(1);
 
   int* data = mm_malloc(sizeof(int));
   assert(data != NULL);
+  assert(((uintptr_t)data & 15) == 0);
   data[0] = 0x162;
+
+  /* neighbouring blocks are merged on free and reused */
+  char* a = mm_malloc(100);
+  char* b = mm_malloc(100);
+  char* c = mm_malloc(100);
+  assert(((uintptr_t)a & 15) == 0 && ((uintptr_t)b & 15) == 0 && ((uintptr_t)c & 15) == 0);
+  mm_free(a);
+  mm_free(b);
+  assert(mm_malloc(200) == a);
+
+  /* realloc keeps the contents */
+  memset(c, 'x', 100);
+  c = mm_realloc(c, 4096);
+  assert(c != NULL && c[0] == 'x' && c[99] == 'x');
+  assert(data[0] == 0x162);
+
+  /* the heap keeps working when something else moves the break */
+  assert(sbrk(4096) != (void*)-1);
+  char* d = mm_malloc(8192);
+  assert(d != NULL && ((uintptr_t)d & 15) == 0);
+  memset(d, 'y', 8192);
+  assert(c[0] == 'x' && data[0] == 0x162);
+  mm_free(d);
+
+  mm_dump_heap(stdout);
   mm_free(data);
+  mm_dump_heap(stdout);
   puts("malloc test successful!");
 }
@@ -7,8 +7,12 @@
 #include <string.h>
 #include <sys/types.h>
 #include <signal.h>
+#include <spawn.h>
+#include <sys/resource.h>
+#include <sys/time.h>
 #include <sys/wait.h>
 #include <termios.h>
+#include <time.h>
 #include <unistd.h>
 
 #include "tokenizer.h"
@@ -28,10 +32,20 @@ struct termios shell_tmodes;
 /* Process group id for the shell */
 pid_t shell_pgid;
 
+extern char** environ;
+
 int cmd_exit(struct tokens* tokens);
 int cmd_help(struct tokens* tokens);
 int cmd_pwd(struct tokens* tokens);
 int cmd_cd(struct tokens* tokens);
+int cmd_hash(struct tokens* tokens);
+int cmd_time(struct tokens* tokens);
+int cmd_jobs(struct tokens* tokens);
+int cmd_fg(struct tokens* tokens);
+int cmd_bg(struct tokens* tokens);
+int cmd_wait(struct tokens* tokens);
+
+void start_session(struct tokens* tokens, int first_token);
 
 /* Built-in command functions take token array (see parse.h) and return int */
 typedef int cmd_fun_t(struct tokens* tokens);
@@ -46,7 +60,13 @@ typedef struct fun_desc {
 fun_desc_t cmd_table[] = {{cmd_help, "?", "show this help menu"},
                           {cmd_exit, "exit", "exit the command shell"},
                           {cmd_pwd, "pwd", "print current diractory"},
-                          {cmd_cd, "cd", "change working directory"}};
+                          {cmd_cd, "cd", "change working directory"},
+                          {cmd_hash, "hash", "list remembered command paths, -r to forget them"},
+                          {cmd_time, "time", "run a pipeline and report its resource usage"},
+                          {cmd_jobs, "jobs", "list background jobs"},
+                          {cmd_fg, "fg", "continue a job in the foreground"},
+                          {cmd_bg, "bg", "continue a stopped job in the background"},
+                          {cmd_wait, "wait", "wait for background jobs to finish"}};
 
 /* Prints a helpful description for the given command */
 int cmd_help(unused struct tokens* tokens) {
@@ -110,6 +130,11 @@ void init_shell() {
     /* Saves the shell's process id */
     shell_pgid = getpid();
 
+    /* The shell hands the terminal to foreground jobs, and must neither be
+     * stopped by ^Z nor when it takes the terminal back. */
+    signal(SIGTSTP, SIG_IGN);
+    signal(SIGTTOU, SIG_IGN);
+
     /* Take control of the terminal */
     tcsetpgrp(shell_terminal, shell_pgid);
 
@@ -118,41 +143,153 @@ void init_shell() {
   }
 }
 
+/* Number of buckets of the command hash */
+#define COMMAND_HASH_SIZE 64
+
+/* A command name and the path it was found at in PATH */
+struct command_hash_entry {
+  char* name;
+  char* path;
+  int hits;
+  struct command_hash_entry* next;
+};
+
+/* Remembered PATH lookups, so every command searches PATH only once */
+static struct command_hash_entry* command_hash[COMMAND_HASH_SIZE];
+
+/* Value of PATH the command hash was filled for */
+static char* command_hash_path = NULL;
+
+/* Result of the last lookup that was found through a relative PATH entry */
+static char* command_unhashed_path = NULL;
+
+static unsigned int command_hash_index(const char* name) {
+  unsigned int h = 5381;
+
+  while (*name) {
+    h = h * 33 + (unsigned char)*name++;
+  }
+
+  return h % COMMAND_HASH_SIZE;
+}
+
+/* Forgets all remembered command paths */
+void command_hash_clear() {
+  for (int i = 0; i < COMMAND_HASH_SIZE; i++) {
+    while (command_hash[i] != NULL) {
+      struct command_hash_entry* entry = command_hash[i];
+      command_hash[i] = entry->next;
+      free(entry->name);
+      free(entry->path);
+      free(entry);
+    }
+  }
+}
+
+/* Searches the directories of PATH for the program, returns a malloc'd path or NULL */
+static char* search_path(const char* path_env, const char* program_name) {
+  size_t name_len = strlen(program_name);
+
+  for (const char* dir = path_env; dir != NULL;) {
+    const char* end = strchr(dir, ':');
+    size_t dir_len = end ? (size_t)(end - dir) : strlen(dir);
+
+    // an empty entry means the current directory
+    char* program_path = malloc(dir_len + name_len + 2);
+    memcpy(program_path, dir_len ? dir : ".", dir_len ? dir_len : 1);
+    program_path[dir_len ? dir_len : 1] = '/';
+    strcpy(program_path + (dir_len ? dir_len : 1) + 1, program_name);
+
+    if (access(program_path, X_OK) == 0) {
+      return program_path;
+    }
+
+    free(program_path);
+    dir = end ? end + 1 : NULL;
+  }
+
+  return NULL;
+}
+
 /*
   resolves path to the program
-  if given path doesn't exist tries to search the program in the PATH
+  names with a slash are used as they are, other names are searched in the
+  PATH, through the command hash, and then in the current directory
+
+  paths found through relative PATH entries (like "." or an empty entry)
+  depend on the working directory, so they are not hashed
+
+  the returned string must not be freed, and is only valid until the next call
  */
 char* resolve_program_path(char* program_name) {
-  if (access(program_name, F_OK) == 0) {
+  if (strchr(program_name, '/') != NULL) {
     return program_name;
   }
 
-  char* path_dirs = malloc(1024);
-  strcpy(path_dirs, getenv("PATH"));
-
-  if (path_dirs == NULL) {
-    return NULL;
+  const char* path_env = getenv("PATH");
+  if (path_env == NULL) {
+    path_env = "";
   }
 
-  char* token = strtok(path_dirs, ":");
-  char* program_path = malloc(128);
+  // remembered paths are only valid for the PATH they were found in
+  if (command_hash_path == NULL || strcmp(command_hash_path, path_env) != 0) {
+    command_hash_clear();
+    free(command_hash_path);
+    command_hash_path = strdup(path_env);
+  }
 
-  while (token != NULL) {
-    strcpy(program_path, token);
-    strcat(program_path, "/");
-    strcat(program_path, program_name);
+  unsigned int index = command_hash_index(program_name);
+  struct command_hash_entry* entry;
 
-    if (access(program_path, F_OK) == 0) {
-      free(path_dirs);
-      return program_path;
+  for (entry = command_hash[index]; entry != NULL; entry = entry->next) {
+    if (strcmp(entry->name, program_name) == 0) {
+      entry->hits++;
+      return entry->path;
     }
+  }
 
-    token = strtok(NULL, ":");
+  char* program_path = search_path(path_env, program_name);
+  if (program_path == NULL) {
+    return access(program_name, F_OK) == 0 ? program_name : NULL;
   }
 
-  free(path_dirs);
+  if (program_path[0] != '/') {
+    free(command_unhashed_path);
+    command_unhashed_path = program_path;
+    return program_path;
+  }
 
-  return NULL;
+  entry = malloc(sizeof(struct command_hash_entry));
+  entry->name = strdup(program_name);
+  entry->path = program_path;
+  entry->hits = 1;
+  entry->next = command_hash[index];
+  command_hash[index] = entry;
+
+  return entry->path;
+}
+
+/* Lists the command hash, or clears it with -r */
+int cmd_hash(struct tokens* tokens) {
+  char* option = tokens_get_token(tokens, 1);
+
+  if (option != NULL && strcmp(option, "-r") == 0) {
+    command_hash_clear();
+    return 1;
+  }
+
+  if (option != NULL) {
+    printf("usage: hash [-r]\n");
+    return 0;
+  }
+
+  for (int i = 0; i < COMMAND_HASH_SIZE; i++) {
+    for (struct command_hash_entry* entry = command_hash[i]; entry != NULL; entry = entry->next) {
+      printf("%4d\t%s\n", entry->hits, entry->path);
+    }
+  }
+
+  return 1;
 }
 
 void print_args(char** args) {
@@ -168,46 +305,400 @@ void print_args(char** args) {
 // pgid that matches pid of the first process of a session
 static int session_pgid = 0;
 
-void run_program(char** args, int in_fd, int out_fd) {
-  pid_t forked_pid = fork();
+// resource usage of the reaped processes of the session, for the time builtin
+static struct rusage session_usage;
 
-  if (forked_pid == -1) {
-    printf("Failed to create new process: %s\n", strerror(errno));
-    return;
+/* One program of a pipeline, with 0 for fds that aren't redirected */
+struct stage {
+  char** args;
+  int in_fd;
+  int out_fd;
+};
+
+/*
+  starts a program of the session without waiting for it
+
+  uses posix_spawn, which glibc implements with a vfork-style clone, so the
+  shell's page tables are not copied for every command. the child joins the
+  session's process group and closes all the FDS of the session (pipe ends
+  and redirected files) once it has duplicated its own ones
+  returns pid of the started process or -1
+ */
+pid_t run_program(struct stage* stage, int* fds, int fds_len) {
+  // resolve in the shell, so the command hash remembers the result
+  char* program_path = stage->args[0] ? resolve_program_path(stage->args[0]) : NULL;
+
+  if (program_path == NULL) {
+    printf("%s: command not found\n", stage->args[0] ? stage->args[0] : "");
+    return -1;
+  }
+
+  posix_spawn_file_actions_t actions;
+  posix_spawnattr_t attr;
+  sigset_t no_signals, job_signals;
+  pid_t pid;
+
+  posix_spawn_file_actions_init(&actions);
+
+  if (stage->in_fd) {
+    posix_spawn_file_actions_adddup2(&actions, stage->in_fd, STDIN_FILENO);
+  }
+
+  if (stage->out_fd) {
+    posix_spawn_file_actions_adddup2(&actions, stage->out_fd, STDOUT_FILENO);
+  }
+
+  // a reader only sees EOF once every copy of the write end is closed
+  for (int i = 0; i < fds_len; i++) {
+    posix_spawn_file_actions_addclose(&actions, fds[i]);
+  }
+
+  // the first program starts a new group, the others join it
+  // signals the shell ignores or blocks get their defaults back
+  posix_spawnattr_init(&attr);
+  sigemptyset(&no_signals);
+  sigemptyset(&job_signals);
+  sigaddset(&job_signals, SIGTSTP);
+  sigaddset(&job_signals, SIGTTOU);
+  posix_spawnattr_setpgroup(&attr, session_pgid);
+  posix_spawnattr_setsigmask(&attr, &no_signals);
+  posix_spawnattr_setsigdefault(&attr, &job_signals);
+  posix_spawnattr_setflags(&attr,
+                           POSIX_SPAWN_SETPGROUP | POSIX_SPAWN_SETSIGMASK | POSIX_SPAWN_SETSIGDEF);
+
+  // don't let the child inherit unwritten output of the shell
+  fflush(stdout);
+
+  int error = posix_spawn(&pid, program_path, &actions, &attr, stage->args, environ);
+
+  posix_spawn_file_actions_destroy(&actions);
+  posix_spawnattr_destroy(&attr);
+
+  if (error != 0) {
+    printf("Failed to create new process: %s\n", strerror(error));
+    return -1;
+  }
+
+  if (!session_pgid) {
+    session_pgid = pid;
+  }
+
+  return pid;
+}
+
+/* Largest number of jobs at a time */
+#define MAX_JOBS 64
+
+/* A pipeline started by the shell */
+struct job {
+  int id; // 1-based, 0 if the slot is free
+  pid_t pgid;
+  pid_t* pids;
+  int pids_len;
+  int running; // processes not reaped yet
+  unsigned long seq; // when the job was last started or stopped
+  bool stopped;
+  bool background;
+  char* command;
+};
+
+/*
+  the job table, also updated by the SIGCHLD handler
+  SIGCHLD is blocked whenever a command line runs, so the handler only
+  reaps while the shell waits for input
+ */
+static struct job jobs[MAX_JOBS];
+
+/* Last value of job seq, the job with the largest one is the current job */
+static unsigned long job_seq = 0;
+
+/* Blocks or unblocks SIGCHLD */
+static void block_sigchld(bool block) {
+  sigset_t set;
+
+  sigemptyset(&set);
+  sigaddset(&set, SIGCHLD);
+  sigprocmask(block ? SIG_BLOCK : SIG_UNBLOCK, &set, NULL);
+}
+
+/* Records the new STATUS of process PID in its job, returns the job or NULL */
+static struct job* update_job(pid_t pid, int status) {
+  for (int i = 0; i < MAX_JOBS; i++) {
+    struct job* job = &jobs[i];
+
+    for (int j = 0; job->id && j < job->pids_len; j++) {
+      if (job->pids[j] != pid) {
+        continue;
+      }
+
+      if (WIFSTOPPED(status)) {
+        job->stopped = true;
+        job->seq = ++job_seq;
+      } else if (WIFCONTINUED(status)) {
+        job->stopped = false;
+      } else {
+        job->running--;
+      }
+      return job;
+    }
+  }
+
+  return NULL;
+}
+
+void sigchld_handler(unused int sig) {
+  int saved_errno = errno;
+  pid_t pid;
+  int status;
+
+  while ((pid = waitpid(-1, &status, WNOHANG | WUNTRACED | WCONTINUED)) > 0) {
+    update_job(pid, status);
+  }
+
+  errno = saved_errno;
+}
+
+/* Takes a free slot of the job table, NULL if there is none */
+static struct job* job_create(struct tokens* tokens, int first_token, int last_token) {
+  for (int i = 0; i < MAX_JOBS; i++) {
+    struct job* job = &jobs[i];
+    if (job->id) {
+      continue;
+    }
+
+    size_t command_len = 1;
+    for (int t = first_token; t < last_token; t++) {
+      command_len += strlen(tokens_get_token(tokens, t)) + 1;
+    }
+
+    memset(job, 0, sizeof(struct job));
+    job->id = i + 1;
+    job->seq = ++job_seq;
+    job->pids = malloc((last_token - first_token) * sizeof(pid_t));
+    job->command = malloc(command_len);
+    job->command[0] = '\0';
+    for (int t = first_token; t < last_token; t++) {
+      if (t > first_token) {
+        strcat(job->command, " ");
+      }
+      strcat(job->command, tokens_get_token(tokens, t));
+    }
+
+    return job;
+  }
+
+  return NULL;
+}
+
+static void job_free(struct job* job) {
+  free(job->pids);
+  free(job->command);
+  job->id = 0;
+}
+
+/*
+  finds the job named by ARG ("%N" or "N"), or the current job if ARG is NULL
+  the current job is the one most recently started or stopped
+ */
+static struct job* job_find(char* arg) {
+  if (arg == NULL) {
+    struct job* current = NULL;
+    for (int i = 0; i < MAX_JOBS; i++) {
+      if (jobs[i].id && (current == NULL || jobs[i].seq > current->seq)) {
+        current = &jobs[i];
+      }
+    }
+    if (current == NULL) {
+      printf("no current job\n");
+    }
+    return current;
+  }
+
+  int id = atoi(arg[0] == '%' ? arg + 1 : arg);
+  if (id < 1 || id > MAX_JOBS || !jobs[id - 1].id) {
+    printf("%s: no such job\n", arg);
+    return NULL;
+  }
+
+  return &jobs[id - 1];
+}
+
+static const char* job_state(struct job* job) {
+  if (job->running == 0) {
+    return "Done";
+  }
+  return job->stopped ? "Stopped" : "Running";
+}
+
+/* Prints the background jobs that finished since the last call and drops them */
+void report_jobs(bool print) {
+  for (int i = 0; i < MAX_JOBS; i++) {
+    if (jobs[i].id && jobs[i].running == 0) {
+      if (print) {
+        printf("[%d] Done\t%s\n", jobs[i].id, jobs[i].command);
+      }
+      job_free(&jobs[i]);
+    }
+  }
+}
+
+/*
+  waits until every process of the job has finished or the job stops
+  a foreground job gets the terminal meanwhile, and its failures are reported
+ */
+void wait_job(struct job* job) {
+  bool foreground = !job->background;
+
+  if (foreground) {
+    session_pgid = job->pgid;
+    if (shell_is_interactive) {
+      tcsetpgrp(shell_terminal, job->pgid);
+    }
   }
 
-  if (forked_pid > 0) {
+  while (job->running > 0 && !job->stopped) {
+    struct rusage usage;
     int status;
+    pid_t pid = wait4(-job->pgid, &status, WUNTRACED, &usage);
 
-    if (!session_pgid) {
-      session_pgid = forked_pid;
+    if (pid == -1) {
+      if (errno == EINTR) {
+        continue;
+      }
+      break;
     }
 
-    setpgid(forked_pid, session_pgid);
+    update_job(pid, status);
+    if (WIFSTOPPED(status)) {
+      continue;
+    }
 
-    waitpid(forked_pid, &status, 0);
+    timeradd(&session_usage.ru_utime, &usage.ru_utime, &session_usage.ru_utime);
+    timeradd(&session_usage.ru_stime, &usage.ru_stime, &session_usage.ru_stime);
+    if (usage.ru_maxrss > session_usage.ru_maxrss) {
+      session_usage.ru_maxrss = usage.ru_maxrss;
+    }
 
-    if (status != EXIT_SUCCESS) {
-      if (status != SIGINT && status != SIGQUIT) {
+    if (foreground && status != EXIT_SUCCESS) {
+      if (status != SIGINT && status != SIGQUIT && status != SIGPIPE) {
         printf("Program failed: %d\n", status);
       }
     }
+  }
 
-    return;
+  if (foreground) {
+    if (shell_is_interactive) {
+      tcsetpgrp(shell_terminal, shell_pgid);
+    }
+    session_pgid = 0;
+  }
+
+  if (job->stopped) {
+    job->background = true;
+    printf("[%d] Stopped\t%s\n", job->id, job->command);
   }
+}
+
+/*
+  starts all the stages at once, so they run concurrently and a producer
+  never blocks on a full pipe whose reader hasn't started yet
+  the started processes are added to JOB
+  a foreground job gets the terminal as soon as its group exists, so the
+  later stages are not stopped for reading it before the shell waits
+ */
+void run_pipeline(struct stage* stages, int stages_len, int* fds, int fds_len, struct job* job) {
+  for (int i = 0; i < stages_len; i++) {
+    pid_t pid = run_program(&stages[i], fds, fds_len);
+
+    if (pid > 0) {
+      job->pids[job->pids_len++] = pid;
+      job->running++;
 
-  if (forked_pid == 0) {
-    if (in_fd) {
-      dup2(in_fd, STDIN_FILENO);
+      if (job->pids_len == 1 && !job->background && shell_is_interactive) {
+        tcsetpgrp(shell_terminal, pid);
+      }
     }
+  }
 
-    if (out_fd) {
-      dup2(out_fd, STDOUT_FILENO);
+  job->pgid = session_pgid;
+
+  for (int i = 0; i < fds_len; i++) {
+    close(fds[i]);
+  }
+}
+
+/* Lists the jobs */
+int cmd_jobs(unused struct tokens* tokens) {
+  for (int i = 0; i < MAX_JOBS; i++) {
+    if (jobs[i].id) {
+      printf("[%d] %s\t%s\n", jobs[i].id, job_state(&jobs[i]), jobs[i].command);
     }
+  }
 
-    execv(resolve_program_path(args[0]), args);
-    exit(EXIT_FAILURE);
+  report_jobs(false);
+  return 1;
+}
+
+/* Continues a job in the foreground and waits for it */
+int cmd_fg(struct tokens* tokens) {
+  struct job* job = job_find(tokens_get_token(tokens, 1));
+
+  if (job == NULL) {
+    return 0;
+  }
+
+  printf("%s\n", job->command);
+  job->background = false;
+  job->stopped = false;
+
+  // hand over the terminal first, or the job stops again as soon as it reads
+  if (shell_is_interactive) {
+    tcsetpgrp(shell_terminal, job->pgid);
+  }
+  kill(-job->pgid, SIGCONT);
+  wait_job(job);
+
+  if (job->running == 0) {
+    job_free(job);
+  }
+  return 1;
+}
+
+/* Continues a stopped job in the background */
+int cmd_bg(struct tokens* tokens) {
+  struct job* job = job_find(tokens_get_token(tokens, 1));
+
+  if (job == NULL) {
+    return 0;
   }
+
+  job->background = true;
+  job->stopped = false;
+  kill(-job->pgid, SIGCONT);
+  printf("[%d] %s &\n", job->id, job->command);
+  return 1;
+}
+
+/* Waits for one job, or for all of them */
+int cmd_wait(struct tokens* tokens) {
+  char* arg = tokens_get_token(tokens, 1);
+
+  if (arg != NULL) {
+    struct job* job = job_find(arg);
+    if (job == NULL) {
+      return 0;
+    }
+    wait_job(job);
+  } else {
+    for (int i = 0; i < MAX_JOBS; i++) {
+      if (jobs[i].id && !jobs[i].stopped) {
+        wait_job(&jobs[i]);
+      }
+    }
+  }
+
+  report_jobs(false);
+  return 1;
 }
 
 void sigquit_handler(int sig) {
@@ -224,108 +715,238 @@ void sigquit_handler(int sig) {
 
   doesn't support a query mixed with pipelines and redirects
   the behavior is undefined
+
+  tokens before FIRST_TOKEN are skipped
+  a final & runs the pipeline as a background job
 */
-void start_session(struct tokens* tokens) {
-  char* args[30];
+void start_session(struct tokens* tokens, int first_token) {
+  int tokens_len = tokens_get_length(tokens);
   char* token;
   int pipe_fds[2];
   int token_i, arg_i = 0;
-  int in = 0, out = 0;
+  bool background = false;
+
+  if (tokens_len <= first_token) {
+    return;
+  }
+
+  // every token can at most start a new stage or open a new fd
+  char** args = malloc((tokens_len + 1) * sizeof(char*));
+  struct stage* stages = malloc(tokens_len * sizeof(struct stage));
+  int* fds = malloc(2 * tokens_len * sizeof(int));
+  int stages_len = 1, fds_len = 0;
+  struct stage* stage = &stages[0];
+
+  stage->args = args;
+  stage->in_fd = 0;
+  stage->out_fd = 0;
 
-  for (token_i = 0; token_i < tokens_get_length(tokens); token_i++, arg_i++) {
+  for (token_i = first_token; token_i < tokens_len; token_i++) {
     token = tokens_get_token(tokens, token_i);
 
     if (token[0] == '|') {
       if (pipe(pipe_fds) == -1) {
         printf("Failed to create new pipe\n");
-        return;
+        break;
       }
 
-      // save pipe's FDs to separate variables
-      // since in case of multiple pipelines
-      // we need to pass FDs from different pipes to some programs:
-      // for example if we have two pipelines:
-      //   - first program receives: stdin:stdin, stdout:pipe1[1]
-      //   - second program receives: stdin:pipe1[0], stdout:pipe2[1]
-      //   - third program receives: stdin:pipe2[0], stdout:stdout
-      out = pipe_fds[1];
-
-      args[arg_i] = NULL;
-      run_program(args, in, out);
-      close(out);
-
-      if (in) {
-        close(in);
-      }
-      in = pipe_fds[0];
+      fds[fds_len++] = pipe_fds[0];
+      fds[fds_len++] = pipe_fds[1];
+
+      // the current program writes into the pipe, the next one reads from it
+      stage->out_fd = pipe_fds[1];
+      args[arg_i++] = NULL;
 
-      // reset arg counter to run next program
-      arg_i = -1;
+      stage = &stages[stages_len++];
+      stage->args = &args[arg_i];
+      stage->in_fd = pipe_fds[0];
+      stage->out_fd = 0;
     } else if (token[0] == '>') {
       // ignore redirect token and filepath
       token_i++;
-      arg_i--;
 
-      out = open(tokens_get_token(tokens, token_i), O_WRONLY | O_APPEND | O_CREAT, 0644);
+      stage->out_fd = open(tokens_get_token(tokens, token_i), O_WRONLY | O_APPEND | O_CREAT, 0644);
 
-      if (out == -1) {
+      if (stage->out_fd == -1) {
         exit(EXIT_FAILURE);
       }
+      fds[fds_len++] = stage->out_fd;
     } else if (token[0] == '<') {
       // ignore redirect token and filepath
       token_i++;
-      arg_i--;
 
-      in = open(tokens_get_token(tokens, token_i), O_RDWR | O_APPEND | O_CREAT, 0644);
+      stage->in_fd = open(tokens_get_token(tokens, token_i), O_RDWR | O_APPEND | O_CREAT, 0644);
 
-      if (in == -1) {
+      if (stage->in_fd == -1) {
         exit(EXIT_FAILURE);
       }
+      fds[fds_len++] = stage->in_fd;
+    } else if (strcmp(token, "&") == 0 && token_i == tokens_len - 1) {
+      background = true;
     } else {
-      args[arg_i] = token;
+      args[arg_i++] = token;
     }
   }
 
   args[arg_i] = NULL;
 
-  run_program(args, in, out);
+  struct job* job = NULL;
+  if (token_i == tokens_len) {
+    job = job_create(tokens, first_token, background ? tokens_len - 1 : tokens_len);
+    if (job == NULL) {
+      printf("Too many jobs\n");
+    }
+  }
+
+  if (job != NULL) {
+    job->background = background;
+    run_pipeline(stages, stages_len, fds, fds_len, job);
+
+    if (job->running == 0) {
+      job_free(job);
+    } else if (background) {
+      if (shell_is_interactive) {
+        printf("[%d] %d\n", job->id, job->pgid);
+      }
+    } else {
+      wait_job(job);
+      if (job->running == 0) {
+        job_free(job);
+      }
+    }
+  } else {
+    for (int i = 0; i < fds_len; i++) {
+      close(fds[i]);
+    }
+  }
+
+  free(args);
+  free(stages);
+  free(fds);
 
   session_pgid = 0; // don't forget to reset pgid after ending the session
 }
 
-int main(unused int argc, unused char* argv[]) {
-  init_shell();
+static void print_time(const char* name, long sec, long usec) {
+  fprintf(stderr, "%s\t%ldm%ld.%03lds\n", name, sec / 60, sec % 60, usec / 1000);
+}
+
+/* Runs the rest of the line as a pipeline and reports its times and peak memory */
+int cmd_time(struct tokens* tokens) {
+  struct timespec start, end;
+
+  memset(&session_usage, 0, sizeof(session_usage));
+  clock_gettime(CLOCK_MONOTONIC, &start);
+
+  start_session(tokens, 1);
+
+  clock_gettime(CLOCK_MONOTONIC, &end);
+
+  long real_usec = (end.tv_sec - start.tv_sec) * 1000000L + (end.tv_nsec - start.tv_nsec) / 1000;
+  print_time("real", real_usec / 1000000, real_usec % 1000000);
+  print_time("user", session_usage.ru_utime.tv_sec, session_usage.ru_utime.tv_usec);
+  print_time("sys", session_usage.ru_stime.tv_sec, session_usage.ru_stime.tv_usec);
+  fprintf(stderr, "maxrss\t%ldK\n", session_usage.ru_maxrss);
+
+  return 1;
+}
+
+/* Runs one command line */
+void run_line(char* line) {
+  block_sigchld(true);
+
+  /* Split our line into words. */
+  struct tokens* tokens = tokenize(line);
+
+  /* Find which built-in function to run. */
+  int fundex = lookup(tokens_get_token(tokens, 0));
+
+  if (fundex >= 0) {
+    cmd_table[fundex].fun(tokens);
+  } else {
+    start_session(tokens, 0);
+  }
+
+  /* Clean up memory */
+  tokens_destroy(tokens);
+
+  report_jobs(shell_is_interactive);
+  block_sigchld(false);
+}
+
+/* Runs the commands of a string or a file without prompting */
+int run_batch(char* commands, FILE* input) {
+  char* line = NULL;
+  size_t line_cap = 0;
+
+  if (commands != NULL) {
+    for (line = strtok(commands, "\n"); line != NULL; line = strtok(NULL, "\n")) {
+      run_line(line);
+    }
+    return 0;
+  }
+
+  while (getline(&line, &line_cap, input) != -1) {
+    run_line(line);
+  }
+
+  free(line);
+  return 0;
+}
+
+int main(int argc, char* argv[]) {
+  struct sigaction sa;
 
   signal(SIGQUIT, sigquit_handler);
   signal(SIGINT, sigquit_handler);
 
-  static char line[4096];
+  /* Reap finished jobs as they exit, without interrupting reads */
+  memset(&sa, 0, sizeof(sa));
+  sa.sa_handler = sigchld_handler;
+  sa.sa_flags = SA_RESTART;
+  sigemptyset(&sa.sa_mask);
+  sigaction(SIGCHLD, &sa, NULL);
+
+  /* shell -c "commands" and shell script run without the terminal */
+  if (argc > 1 && strcmp(argv[1], "-c") == 0) {
+    if (argc < 3) {
+      fprintf(stderr, "-c requires an argument\n");
+      return 2;
+    }
+    return run_batch(argv[2], NULL);
+  }
+
+  if (argc > 1) {
+    FILE* script = fopen(argv[1], "r");
+
+    if (script == NULL) {
+      fprintf(stderr, "%s: %s\n", argv[1], strerror(errno));
+      return 1;
+    }
+
+    int result = run_batch(NULL, script);
+    fclose(script);
+    return result;
+  }
+
+  init_shell();
+
+  char* line = NULL;
+  size_t line_cap = 0;
   int line_num = 0;
 
   /* Please only print shell prompts when standard input is not a tty */
   if (shell_is_interactive)
     fprintf(stdout, "%d: ", line_num);
 
-  while (fgets(line, 4096, stdin)) {
-    /* Split our line into words. */
-    struct tokens* tokens = tokenize(line);
-
-    /* Find which built-in function to run. */
-    int fundex = lookup(tokens_get_token(tokens, 0));
-
-    if (fundex >= 0) {
-      cmd_table[fundex].fun(tokens);
-    } else {
-      start_session(tokens);
-    }
+  while (getline(&line, &line_cap, stdin) != -1) {
+    run_line(line);
 
     if (shell_is_interactive)
       /* Please only print shell prompts when standard input is not a tty */
       fprintf(stdout, "%d: ", ++line_num);
-
-    /* Clean up memory */
-    tokens_destroy(tokens);
   }
 
+  free(line);
   return 0;
 }
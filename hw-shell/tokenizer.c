@@ -3,25 +3,26 @@
 #include <string.h>
 #include "tokenizer.h"
 
+/*
+ * All the words of a line live in BUFFER, NUL-terminated one after another,
+ * and OFFSETS holds where each of them starts. A line of N bytes never needs
+ * more than N + 1 bytes of words, so the buffer is allocated once along with
+ * the struct.
+ */
 struct tokens {
   size_t tokens_length;
-  char** tokens;
-  size_t buffers_length;
-  char** buffers;
+  size_t tokens_capacity;
+  size_t* offsets;
+  char buffer[];
 };
 
-static void* vector_push(char*** pointer, size_t* size, void* elem) {
-  *pointer = (char**)realloc(*pointer, sizeof(char*) * (*size + 1));
-  (*pointer)[*size] = elem;
-  *size += 1;
-  return elem;
-}
-
-static void* copy_word(char* source, size_t n) {
-  source[n] = '\0';
-  char* word = (char*)malloc(n + 1);
-  strncpy(word, source, n + 1);
-  return word;
+static void push_offset(struct tokens* tokens, size_t offset) {
+  if (tokens->tokens_length == tokens->tokens_capacity) {
+    tokens->tokens_capacity = tokens->tokens_capacity ? 2 * tokens->tokens_capacity : 16;
+    tokens->offsets =
+        (size_t*)realloc(tokens->offsets, sizeof(size_t) * tokens->tokens_capacity);
+  }
+  tokens->offsets[tokens->tokens_length++] = offset;
 }
 
 struct tokens* tokenize(const char* line) {
@@ -29,16 +30,15 @@ struct tokens* tokenize(const char* line) {
     return NULL;
   }
 
-  static char token[4096];
-  size_t n = 0, n_max = 4096;
-  struct tokens* tokens;
   size_t line_length = strlen(line);
-
-  tokens = (struct tokens*)malloc(sizeof(struct tokens));
+  struct tokens* tokens = (struct tokens*)malloc(sizeof(struct tokens) + line_length + 1);
   tokens->tokens_length = 0;
-  tokens->tokens = NULL;
-  tokens->buffers_length = 0;
-  tokens->buffers = NULL;
+  tokens->tokens_capacity = 0;
+  tokens->offsets = NULL;
+
+  /* The word being read is TOKEN[0, n), at offset START of the buffer. */
+  size_t start = 0, n = 0;
+  char* token = tokens->buffer;
 
   const int MODE_NORMAL = 0, MODE_SQUOTE = 1, MODE_DQUOTE = 2;
   int mode = MODE_NORMAL;
@@ -56,8 +56,10 @@ struct tokens* tokenize(const char* line) {
         }
       } else if (isspace(c)) {
         if (n > 0) {
-          void* word = copy_word(token, n);
-          vector_push(&tokens->tokens, &tokens->tokens_length, word);
+          token[n] = '\0';
+          push_offset(tokens, start);
+          start += n + 1;
+          token += n + 1;
           n = 0;
         }
       } else {
@@ -84,14 +86,11 @@ struct tokens* tokenize(const char* line) {
         token[n++] = c;
       }
     }
-    if (n + 1 >= n_max)
-      abort();
   }
 
   if (n > 0) {
-    void* word = copy_word(token, n);
-    vector_push(&tokens->tokens, &tokens->tokens_length, word);
-    n = 0;
+    token[n] = '\0';
+    push_offset(tokens, start);
   }
   return tokens;
 }
@@ -108,7 +107,7 @@ char* tokens_get_token(struct tokens* tokens, size_t n) {
   if (tokens == NULL || n >= tokens->tokens_length) {
     return NULL;
   } else {
-    return tokens->tokens[n];
+    return tokens->buffer + tokens->offsets[n];
   }
 }
 
@@ -116,14 +115,6 @@ void tokens_destroy(struct tokens* tokens) {
   if (tokens == NULL) {
     return;
   }
-  for (int i = 0; i < tokens->tokens_length; i++) {
-    free(tokens->tokens[i]);
-  }
-  for (int i = 0; i < tokens->buffers_length; i++) {
-    free(tokens->buffers[i]);
-  }
-  if (tokens->tokens) {
-    free(tokens->tokens);
-  }
+  free(tokens->offsets);
   free(tokens);
 }
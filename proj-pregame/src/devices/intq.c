@@ -87,5 +87,6 @@ static void signal(struct intq* q UNUSED, struct thread** waiter) {
   if (*waiter != NULL) {
     thread_unblock(*waiter);
     *waiter = NULL;
+    thread_check_preempt();
   }
 }
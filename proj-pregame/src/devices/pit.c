@@ -11,9 +11,6 @@
 #define PIT_PORT_CONTROL 0x43                        /* Control port. */
 #define PIT_PORT_COUNTER(CHANNEL) (0x40 + (CHANNEL)) /* Counter port. */
 
-/* PIT cycles per second. */
-#define PIT_HZ 1193180
-
 /* Configure the given CHANNEL in the PIT.  In a PC, the PIT's
    three output channels are hooked up like this:
 
@@ -75,3 +72,41 @@ void pit_configure_channel(int channel, int mode, int frequency) {
   outb(PIT_PORT_COUNTER(channel), count >> 8);
   intr_set_level(old_level);
 }
+
+/* Starts channel 0 counting down COUNT cycles once, in mode 0
+   ("interrupt on terminal count"): its output, and so interrupt
+   line 0, rises when the count reaches zero and then stays high,
+   so exactly one interrupt is raised.  The counter keeps counting
+   down past zero, wrapping around to 65535.  A COUNT of 0 counts
+   65536 cycles.
+
+   Calling pit_configure_channel() afterward returns the channel
+   to periodic operation. */
+void pit_start_oneshot(int channel, uint16_t count) {
+  enum intr_level old_level;
+
+  ASSERT(channel == 0);
+
+  old_level = intr_disable();
+  outb(PIT_PORT_CONTROL, (channel << 6) | 0x30);
+  outb(PIT_PORT_COUNTER(channel), count);
+  outb(PIT_PORT_COUNTER(channel), count >> 8);
+  intr_set_level(old_level);
+}
+
+/* Returns the current count of CHANNEL, latched so that the two
+   bytes are read consistently. */
+uint16_t pit_read_count(int channel) {
+  enum intr_level old_level;
+  uint16_t count;
+
+  ASSERT(channel == 0 || channel == 2);
+
+  old_level = intr_disable();
+  outb(PIT_PORT_CONTROL, channel << 6);
+  count = inb(PIT_PORT_COUNTER(channel));
+  count |= inb(PIT_PORT_COUNTER(channel)) << 8;
+  intr_set_level(old_level);
+
+  return count;
+}
@@ -20,11 +20,34 @@
 /* Number of timer ticks since OS booted. */
 static int64_t ticks;
 
+/* Threads blocked in timer_sleep(), in order of wakeup_tick,
+   earliest first.  Threads with the same wakeup_tick are kept in
+   the order they went to sleep. */
+static struct list sleep_list;
+
 /* Number of loops per timer tick.
    Initialized by timer_calibrate(). */
 static unsigned loops_per_tick;
 
+/* Tickless mode, enabled by the "-tickless" kernel command-line
+   option.  While no thread is ready to run, other than the one
+   running, periodic ticks only wake the CPU to find nothing to
+   do.  Instead, the PIT is started in one-shot mode to interrupt
+   at the next sleeper's wakeup tick, and the interrupt then runs
+   every tick skipped in one go.  The 16-bit PIT counter limits a
+   one-shot to ONESHOT_MAX_TICKS, about 55 ms.  Periodic ticks
+   resume as soon as a thread becomes ready, at the next tick
+   boundary, see timer_resume_ticks(). */
+#define CYCLES_PER_TICK ((PIT_HZ + TIMER_FREQ / 2) / TIMER_FREQ)
+#define ONESHOT_MAX_TICKS (65535 / CYCLES_PER_TICK)
+static bool tickless;
+static int oneshot_ticks;     /* Ticks the pending one-shot covers, 0 if periodic. */
+static unsigned oneshot_count; /* PIT cycles the pending one-shot was started with. */
+
 static intr_handler_func timer_interrupt;
+static bool wakes_earlier(const struct list_elem* a, const struct list_elem* b, void* aux);
+static int oneshot_elapsed(void);
+static void start_oneshot(void);
 static bool too_many_loops(unsigned loops);
 static void busy_wait(int64_t loops);
 static void real_time_sleep(int64_t num, int32_t denom);
@@ -33,6 +56,7 @@ static void real_time_delay(int64_t num, int32_t denom);
 /* Sets up the timer to interrupt TIMER_FREQ times per second,
    and registers the corresponding interrupt. */
 void timer_init(void) {
+  list_init(&sleep_list);
   pit_configure_channel(0, 2, TIMER_FREQ);
   intr_register_ext(0x20, timer_interrupt, "8254 Timer");
 }
@@ -64,7 +88,7 @@ void timer_calibrate(void) {
 /* Returns the number of timer ticks since the OS booted. */
 int64_t timer_ticks(void) {
   enum intr_level old_level = intr_disable();
-  int64_t t = ticks;
+  int64_t t = ticks + oneshot_elapsed();
   intr_set_level(old_level);
   return t;
 }
@@ -73,14 +97,32 @@ int64_t timer_ticks(void) {
    should be a value once returned by timer_ticks(). */
 int64_t timer_elapsed(int64_t then) { return timer_ticks() - then; }
 
-/* Sleeps for approximately TICKS timer ticks.  Interrupts must
-   be turned on. */
-void timer_sleep(int64_t ticks) {
-  int64_t start = timer_ticks();
+/* Sleeps for approximately SLEEP_TICKS timer ticks.  Interrupts
+   must be turned on.
+
+   The thread blocks on the sleep queue and is unblocked by the
+   timer interrupt once SLEEP_TICKS ticks have passed, so it takes
+   no CPU time while asleep. */
+void timer_sleep(int64_t sleep_ticks) {
+  struct thread* cur = thread_current();
+  enum intr_level old_level;
 
   ASSERT(intr_get_level() == INTR_ON);
-  while (timer_elapsed(start) < ticks)
-    thread_yield();
+  if (sleep_ticks <= 0)
+    return;
+
+  old_level = intr_disable();
+  cur->wakeup_tick = timer_ticks() + sleep_ticks;
+  list_insert_ordered(&sleep_list, &cur->elem, wakes_earlier, NULL);
+
+  /* A one-shot started before this sleeper existed may run past
+     its wakeup tick.  TICKS still holds the tick the one-shot
+     started at. */
+  if (oneshot_ticks > 0 && cur->wakeup_tick < ticks + oneshot_ticks)
+    timer_resume_ticks();
+
+  thread_block();
+  intr_set_level(old_level);
 }
 
 /* Sleeps for approximately MS milliseconds.  Interrupts must be
@@ -125,10 +167,115 @@ void timer_ndelay(int64_t ns) { real_time_delay(ns, 1000 * 1000 * 1000); }
 /* Prints timer statistics. */
 void timer_print_stats(void) { printf("Timer: %" PRId64 " ticks\n", timer_ticks()); }
 
+/* Enables tickless mode.  Must be called after timer_calibrate(),
+   which counts loops between periodic ticks. */
+void timer_enable_tickless(void) { tickless = true; }
+
+/* Returns true if tickless mode is enabled. */
+bool timer_tickless(void) { return tickless; }
+
+/* Ends a pending one-shot early, because a thread became ready
+   and time slices have to be enforced again.  The PIT is restarted
+   to interrupt at the next tick boundary, where timer_interrupt()
+   catches up on the ticks that passed and resumes periodic
+   ticks.  Does nothing if the timer is periodic.
+
+   This function must be called with interrupts turned off. */
+void timer_resume_ticks(void) {
+  int elapsed_cycles, next;
+
+  ASSERT(intr_get_level() == INTR_OFF);
+
+  if (oneshot_ticks == 0)
+    return;
+
+  elapsed_cycles = (int)oneshot_count - pit_read_count(0);
+  if (elapsed_cycles < 0)
+    return; /* Already fired, the interrupt is pending. */
+
+  next = elapsed_cycles / CYCLES_PER_TICK + 1;
+  if (next >= oneshot_ticks)
+    return;
+
+  oneshot_count = next * CYCLES_PER_TICK;
+  oneshot_ticks = next;
+  pit_start_oneshot(0, oneshot_count - elapsed_cycles);
+}
+
+/* Returns the number of whole ticks that have passed since the
+   pending one-shot was started, 0 if the timer is periodic. */
+static int oneshot_elapsed(void) {
+  int elapsed_cycles;
+
+  if (oneshot_ticks == 0)
+    return 0;
+
+  elapsed_cycles = (int)oneshot_count - pit_read_count(0);
+  if (elapsed_cycles < 0)
+    return oneshot_ticks; /* Counted past zero. */
+  return elapsed_cycles / CYCLES_PER_TICK;
+}
+
+/* Called at the end of each timer interrupt in tickless mode.
+   Starts a one-shot that covers the ticks until the next
+   sleeper's wakeup if no thread is ready, otherwise makes sure
+   the timer is periodic. */
+static void start_oneshot(void) {
+  int64_t next = ticks + ONESHOT_MAX_TICKS;
+
+  if (!list_empty(&sleep_list)) {
+    int64_t wakeup = list_entry(list_front(&sleep_list), struct thread, elem)->wakeup_tick;
+    if (wakeup < next)
+      next = wakeup;
+  }
+
+  if (thread_ready_count() == 0 && next - ticks >= 2) {
+    oneshot_ticks = next - ticks;
+    oneshot_count = oneshot_ticks * CYCLES_PER_TICK;
+    pit_start_oneshot(0, oneshot_count);
+  }
+}
+
 /* Timer interrupt handler. */
 static void timer_interrupt(struct intr_frame* args UNUSED) {
-  ticks++;
-  thread_tick();
+  /* A one-shot covers several ticks; run each of them, so the
+     scheduler's per-tick accounting is the same as with periodic
+     ticks. */
+  int elapsed = 1;
+  if (oneshot_ticks > 0) {
+    elapsed = oneshot_ticks;
+    oneshot_ticks = 0;
+    pit_configure_channel(0, 2, TIMER_FREQ);
+  }
+
+  while (elapsed-- > 0) {
+    ticks++;
+
+    /* Wake the sleepers that are due.  The queue is sorted, so
+       this stops at the first one that is not. */
+    while (!list_empty(&sleep_list)) {
+      struct thread* t = list_entry(list_front(&sleep_list), struct thread, elem);
+      if (t->wakeup_tick > ticks)
+        break;
+      list_pop_front(&sleep_list);
+      thread_unblock(t);
+    }
+
+    thread_tick();
+  }
+
+  thread_check_preempt();
+  if (tickless)
+    start_oneshot();
+}
+
+/* Orders threads on the sleep queue by wakeup_tick.  Ties compare
+   false, so list_insert_ordered() puts a new sleeper after the
+   ones already due at the same tick. */
+static bool wakes_earlier(const struct list_elem* a, const struct list_elem* b,
+                          void* aux UNUSED) {
+  return list_entry(a, struct thread, elem)->wakeup_tick <
+         list_entry(b, struct thread, elem)->wakeup_tick;
 }
 
 /* Returns true if LOOPS iterations waits for more than one timer
@@ -2,6 +2,7 @@
 #define DEVICES_TIMER_H
 
 #include <round.h>
+#include <stdbool.h>
 #include <stdint.h>
 
 /* Number of timer interrupts per second. */
@@ -26,4 +27,9 @@ void timer_ndelay(int64_t nanoseconds);
 
 void timer_print_stats(void);
 
+/* Tickless mode, see timer.c. */
+void timer_enable_tickless(void);
+bool timer_tickless(void);
+void timer_resume_ticks(void);
+
 #endif /* devices/timer.h */
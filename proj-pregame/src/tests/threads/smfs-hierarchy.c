@@ -26,7 +26,7 @@ int counters[8];
 char* thread_names[8] = {"t-min+00", "t-min+08", "t-min+16", "t-min+24",
                          "t-min+32", "t-min+40", "t-min+48", "t-min+56"};
 
-struct semaphore barrier_sema;
+static struct semaphore barrier_sema;
 static bool keep_looping = true;
 
 void test_smfs_hierarchy(size_t num_threads) {
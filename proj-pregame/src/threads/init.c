@@ -60,6 +60,9 @@ static const char* swap_bdev_name;
 /* -ul: Maximum number of pages to put into palloc's user pool. */
 static size_t user_page_limit = SIZE_MAX;
 
+/* -tickless: Stop periodic timer ticks while no thread is ready. */
+static bool tickless;
+
 static void bss_init(void);
 static void paging_init(void);
 
@@ -119,6 +122,8 @@ int main(void) {
   thread_start();
   serial_init_queue();
   timer_calibrate();
+  if (tickless)
+    timer_enable_tickless();
 
 #ifdef USERPROG
   /* Give main thread a minimal PCB so it can launch the first process */
@@ -249,6 +254,8 @@ static char** parse_options(char** argv) {
 #endif
     else if (!strcmp(name, "-rs"))
       random_init(atoi(value));
+    else if (!strcmp(name, "-tickless"))
+      tickless = true;
     else if (!strcmp(name, "-sched")) {
       if (!strcmp(value, "fifo"))
         scheduler_flags[SCHED_FIFO] = 1;
@@ -427,6 +434,7 @@ static void usage(void) {
 #endif // VM
 #endif // FILESYS
          "  -rs=SEED           Set random number seed to SEED.\n"
+         "  -tickless          Stop timer ticks while idle, and size time slices by load.\n"
          "  -sched-fair        Use alternate non-strict priority scheduler. Mutually exclusive "
          "with \"-sched-mlfqs\", \"-sched-prio\".\n"
          "  -sched-mlfqs       Use multi-level feedback queue scheduler. Mutually exclusive with "
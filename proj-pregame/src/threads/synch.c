@@ -32,6 +32,13 @@
 #include "threads/interrupt.h"
 #include "threads/thread.h"
 
+/* Longest chain of lock holders that a donation is passed along,
+   so that a long or circular chain cannot stall lock_acquire(). */
+#define DONATION_DEPTH 8
+
+static bool priority_ordered(void);
+static bool higher_priority(const struct list_elem* a, const struct list_elem* b, void* aux);
+
 /* Initializes semaphore SEMA to VALUE.  A semaphore is a
    nonnegative integer along with two atomic operators for
    manipulating it:
@@ -63,7 +70,10 @@ void sema_down(struct semaphore* sema) {
 
   old_level = intr_disable();
   while (sema->value == 0) {
-    list_push_back(&sema->waiters, &thread_current()->elem);
+    if (priority_ordered())
+      list_insert_ordered(&sema->waiters, &thread_current()->elem, higher_priority, NULL);
+    else
+      list_push_back(&sema->waiters, &thread_current()->elem);
     thread_block();
   }
   sema->value--;
@@ -94,6 +104,8 @@ bool sema_try_down(struct semaphore* sema) {
 
 /* Up or "V" operation on a semaphore.  Increments SEMA's value
    and wakes up one thread of those waiting for SEMA, if any.
+   Under the priority scheduler that is the highest-priority one,
+   since waiters are kept in priority order.
 
    This function may be called from an interrupt handler. */
 void sema_up(struct semaphore* sema) {
@@ -105,9 +117,22 @@ void sema_up(struct semaphore* sema) {
   if (!list_empty(&sema->waiters))
     thread_unblock(list_entry(list_pop_front(&sema->waiters), struct thread, elem));
   sema->value++;
+  thread_check_preempt();
   intr_set_level(old_level);
 }
 
+/* Returns true if wait lists should be kept in priority order,
+   highest first, which is the case for the priority scheduler. */
+static bool priority_ordered(void) { return active_sched_policy == SCHED_PRIO; }
+
+/* Orders threads by descending priority.  Ties compare false, so
+   list_insert_ordered() keeps equal priorities in FIFO order. */
+static bool higher_priority(const struct list_elem* a, const struct list_elem* b,
+                            void* aux UNUSED) {
+  return list_entry(a, struct thread, elem)->priority >
+         list_entry(b, struct thread, elem)->priority;
+}
+
 static void sema_test_helper(void* sema_);
 
 /* Self-test for semaphores that makes control "ping-pong"
@@ -161,6 +186,32 @@ void lock_init(struct lock* lock) {
   sema_init(&lock->semaphore, 1);
 }
 
+/* Donates PRIORITY to the holder of LOCK, and on along the chain
+   of locks that holder is itself waiting for, at most
+   DONATION_DEPTH links.  Stops early at a holder that already
+   has at least PRIORITY, since everything further along the
+   chain then has it too.
+
+   This function must be called with interrupts turned off. */
+static void donate_priority(struct lock* lock, int priority) {
+  for (int depth = 0; lock != NULL && depth < DONATION_DEPTH; depth++) {
+    struct thread* holder = lock->holder;
+    if (holder == NULL || holder->priority >= priority)
+      break;
+
+    thread_set_effective_priority(holder, priority);
+
+    /* A holder that is blocked acquiring another lock has to move
+       up that lock's waiters.  One that is ready was just handed
+       the lock and has not run to clear waiting_lock yet. */
+    lock = holder->waiting_lock;
+    if (lock != NULL && holder->status == THREAD_BLOCKED) {
+      list_remove(&holder->elem);
+      list_insert_ordered(&lock->semaphore.waiters, &holder->elem, higher_priority, NULL);
+    }
+  }
+}
+
 /* Acquires LOCK, sleeping until it becomes available if
    necessary.  The lock must not already be held by the current
    thread.
@@ -168,14 +219,30 @@ void lock_init(struct lock* lock) {
    This function may sleep, so it must not be called within an
    interrupt handler.  This function may be called with
    interrupts disabled, but interrupts will be turned back on if
-   we need to sleep. */
+   we need to sleep.
+
+   Under the priority scheduler, a thread that has to wait
+   donates its priority to the holder, see donate_priority(). */
 void lock_acquire(struct lock* lock) {
+  struct thread* cur = thread_current();
+  enum intr_level old_level;
+
   ASSERT(lock != NULL);
   ASSERT(!intr_context());
   ASSERT(!lock_held_by_current_thread(lock));
 
+  old_level = intr_disable();
+  if (lock->holder != NULL && priority_ordered()) {
+    cur->waiting_lock = lock;
+    donate_priority(lock, cur->priority);
+  }
+
   sema_down(&lock->semaphore);
-  lock->holder = thread_current();
+
+  cur->waiting_lock = NULL;
+  lock->holder = cur;
+  list_push_back(&cur->held_locks, &lock->elem);
+  intr_set_level(old_level);
 }
 
 /* Tries to acquires LOCK and returns true if successful or false
@@ -191,8 +258,12 @@ bool lock_try_acquire(struct lock* lock) {
   ASSERT(!lock_held_by_current_thread(lock));
 
   success = sema_try_down(&lock->semaphore);
-  if (success)
+  if (success) {
+    enum intr_level old_level = intr_disable();
     lock->holder = thread_current();
+    list_push_back(&thread_current()->held_locks, &lock->elem);
+    intr_set_level(old_level);
+  }
   return success;
 }
 
@@ -200,13 +271,24 @@ bool lock_try_acquire(struct lock* lock) {
 
    An interrupt handler cannot acquire a lock, so it does not
    make sense to try to release a lock within an interrupt
-   handler. */
+   handler.
+
+   Drops any priority donated through LOCK.  The remaining
+   donations come from the first waiter of each other lock held,
+   so this does not rescan every waiting thread. */
 void lock_release(struct lock* lock) {
+  struct thread* cur = thread_current();
+  enum intr_level old_level;
+
   ASSERT(lock != NULL);
   ASSERT(lock_held_by_current_thread(lock));
 
+  old_level = intr_disable();
+  list_remove(&lock->elem);
   lock->holder = NULL;
+  thread_update_priority(cur);
   sema_up(&lock->semaphore);
+  intr_set_level(old_level);
 }
 
 /* Returns true if the current thread holds LOCK, false
@@ -280,8 +362,17 @@ void rw_lock_release(struct rw_lock* rw_lock, bool reader) {
 struct semaphore_elem {
   struct list_elem elem;      /* List element. */
   struct semaphore semaphore; /* This semaphore. */
+  int priority;               /* Priority of the thread waiting on it. */
 };
 
+/* Orders condition waiters by descending priority, keeping
+   equal priorities in FIFO order. */
+static bool higher_priority_waiter(const struct list_elem* a, const struct list_elem* b,
+                                   void* aux UNUSED) {
+  return list_entry(a, struct semaphore_elem, elem)->priority >
+         list_entry(b, struct semaphore_elem, elem)->priority;
+}
+
 /* Initializes condition variable COND.  A condition variable
    allows one piece of code to signal a condition and cooperating
    code to receive the signal and act upon it. */
@@ -320,7 +411,11 @@ void cond_wait(struct condition* cond, struct lock* lock) {
   ASSERT(lock_held_by_current_thread(lock));
 
   sema_init(&waiter.semaphore, 0);
-  list_push_back(&cond->waiters, &waiter.elem);
+  waiter.priority = thread_current()->priority;
+  if (priority_ordered())
+    list_insert_ordered(&cond->waiters, &waiter.elem, higher_priority_waiter, NULL);
+  else
+    list_push_back(&cond->waiters, &waiter.elem);
   lock_release(lock);
   sema_down(&waiter.semaphore);
   lock_acquire(lock);
@@ -11,6 +11,7 @@
 #include "threads/switch.h"
 #include "threads/synch.h"
 #include "threads/vaddr.h"
+#include "devices/timer.h"
 #ifdef USERPROG
 #include "userprog/process.h"
 #endif
@@ -24,6 +25,28 @@
    that are ready to run but not actually running. */
 static struct list fifo_ready_list;
 
+/* Ready queues of the strict priority scheduler, one per
+   priority, and a bitmap with bit P set iff queue P is not
+   empty.  Picking the next thread is a find-last-set on the
+   bitmap instead of a scan, so it takes constant time however
+   many threads are ready. */
+#define PRIO_BITMAP_WORDS ((PRI_MAX + 32) / 32)
+static struct list prio_ready_lists[PRI_MAX + 1];
+static uint32_t prio_ready_bitmap[PRIO_BITMAP_WORDS];
+
+/* Ready threads of the fair (stride) scheduler, as a binary
+   min-heap ordered by pass, then by enqueue order.  A thread's
+   pass advances by its stride, STRIDE_ONE / weight, for every
+   tick it runs, and the weight grows with priority, so picking
+   the least pass gives each thread a share of the CPU in
+   proportion to its weight and never starves a low priority. */
+#define FAIR_HEAP_SIZE 1024
+#define STRIDE_ONE (1 << 20)
+static struct thread* fair_heap[FAIR_HEAP_SIZE];
+static size_t fair_heap_len;
+static int64_t fair_vtime;     /* Pass of the thread picked last. */
+static unsigned fair_next_seq; /* Next enqueue sequence number. */
+
 /* List of all processes.  Processes are added to this list
    when they are first scheduled and removed when they exit. */
 static struct list all_list;
@@ -52,12 +75,36 @@ static long long user_ticks;   /* # of timer ticks in user programs. */
 /* Scheduling. */
 #define TIME_SLICE 4          /* # of timer ticks to give each thread. */
 static unsigned thread_ticks; /* # of timer ticks since last yield. */
+static int ready_count;       /* # of threads on the ready structure. */
+
+/* In tickless mode, time slices shrink as more threads are ready,
+   so that each gets a turn within about SLICE_LATENCY ticks, but
+   a thread with few competitors switches less often. */
+#define SLICE_LATENCY 24 /* Target ticks for every ready thread to run. */
+#define SLICE_MIN 2      /* Shortest time slice. */
+#define SLICE_MAX 12     /* Longest time slice. */
+
+/* MLFQS. */
+#define MLFQS_PRIORITY_TICKS 4 /* # of timer ticks between priority updates. */
+static fixed_point_t load_avg; /* System load average. */
 
 static void init_thread(struct thread*, const char* name, int priority);
 static bool is_thread(struct thread*) UNUSED;
 static void* alloc_frame(struct thread*, size_t size);
 static void schedule(void);
 static void thread_enqueue(struct thread* t);
+static bool thread_should_preempt(void);
+static unsigned time_slice(void);
+static void prio_enqueue(struct thread* t);
+static void prio_dequeue(struct thread* t);
+static int prio_highest_ready(void);
+static bool prio_scheduled(void);
+static int mlfqs_priority(struct thread* t);
+static void mlfqs_update_recent_cpu(struct thread* t, void* aux);
+static void mlfqs_update_priority(struct thread* t, void* aux);
+static void mlfqs_tick(struct thread* cur);
+static void fair_enqueue(struct thread* t);
+static int fair_stride(struct thread* t);
 static tid_t allocate_tid(void);
 void thread_switch_tail(struct thread* prev);
 
@@ -108,6 +155,8 @@ void thread_init(void) {
 
   lock_init(&tid_lock);
   list_init(&fifo_ready_list);
+  for (int i = PRI_MIN; i <= PRI_MAX; i++)
+    list_init(&prio_ready_lists[i]);
   list_init(&all_list);
 
   /* Set up a thread structure for the running thread. */
@@ -147,11 +196,41 @@ void thread_tick(void) {
   else
     kernel_ticks++;
 
+  if (active_sched_policy == SCHED_MLFQS)
+    mlfqs_tick(t);
+  else if (active_sched_policy == SCHED_FAIR && t != idle_thread)
+    t->pass += fair_stride(t);
+
   /* Enforce preemption. */
-  if (++thread_ticks >= TIME_SLICE)
+  if (++thread_ticks >= time_slice())
     intr_yield_on_return();
 }
 
+/* Returns the length of the running thread's time slice, in
+   ticks. */
+static unsigned time_slice(void) {
+  int slice;
+
+  if (!timer_tickless())
+    return TIME_SLICE;
+
+  slice = SLICE_LATENCY / (ready_count + 1);
+  if (slice < SLICE_MIN)
+    return SLICE_MIN;
+  if (slice > SLICE_MAX)
+    return SLICE_MAX;
+  return slice;
+}
+
+/* Returns the number of threads ready to run, not counting the
+   running thread.
+
+   This function must be called with interrupts turned off. */
+int thread_ready_count(void) {
+  ASSERT(intr_get_level() == INTR_OFF);
+  return ready_count;
+}
+
 /* Prints thread statistics. */
 void thread_print_stats(void) {
   printf("Thread: %lld idle ticks, %lld kernel ticks, %lld user ticks\n", idle_ticks, kernel_ticks,
@@ -170,14 +249,19 @@ void thread_print_stats(void) {
    scheduled.  Use a semaphore or some other form of
    synchronization if you need to ensure ordering.
 
-   The code provided sets the new thread's `priority' member to
-   PRIORITY, but no actual priority scheduling is implemented.
-   Priority scheduling is the goal of Problem 1-3. */
+   The new thread is queued like any unblocked thread, on the
+   ready structure of the active scheduling policy.  Under the
+   priority and MLFQS schedulers it preempts its creator at once
+   if its priority is higher; under MLFQS, PRIORITY is replaced by
+   one computed from the nice value and recent CPU inherited from
+   the creator.  Under the FIFO and fair schedulers it waits for
+   its turn. */
 tid_t thread_create(const char* name, int priority, thread_func* function, void* aux) {
   struct thread* t;
   struct kernel_thread_frame* kf;
   struct switch_entry_frame* ef;
   struct switch_threads_frame* sf;
+  enum intr_level old_level;
   tid_t tid;
 
   ASSERT(function != NULL);
@@ -187,8 +271,19 @@ tid_t thread_create(const char* name, int priority, thread_func* function, void*
   if (t == NULL)
     return TID_ERROR;
 
-  /* Initialize thread. */
+  /* Initialize thread.  The fair scheduler's heap holds at most
+     FAIR_HEAP_SIZE ready threads, and every thread but the
+     running one may be ready at once, so refuse threads beyond
+     that.  Checking and joining all_list with interrupts off
+     keeps concurrent creators from both taking the last slot. */
+  old_level = intr_disable();
+  if (active_sched_policy == SCHED_FAIR && list_size(&all_list) > FAIR_HEAP_SIZE) {
+    intr_set_level(old_level);
+    palloc_free_page(t);
+    return TID_ERROR;
+  }
   init_thread(t, name, priority);
+  intr_set_level(old_level);
   tid = t->tid = allocate_tid();
 
   /* Stack frame for kernel_thread(). */
@@ -208,6 +303,7 @@ tid_t thread_create(const char* name, int priority, thread_func* function, void*
 
   /* Add to run queue. */
   thread_unblock(t);
+  thread_check_preempt();
 
   return tid;
 }
@@ -234,8 +330,18 @@ static void thread_enqueue(struct thread* t) {
   ASSERT(intr_get_level() == INTR_OFF);
   ASSERT(is_thread(t));
 
+  ready_count++;
   if (active_sched_policy == SCHED_FIFO)
     list_push_back(&fifo_ready_list, &t->elem);
+  else if (active_sched_policy == SCHED_PRIO)
+    prio_enqueue(t);
+  else if (active_sched_policy == SCHED_MLFQS) {
+    /* The recent_cpu of a thread only changes while it runs, so
+       its priority is brought up to date as it leaves the CPU. */
+    t->priority = mlfqs_priority(t);
+    prio_enqueue(t);
+  } else if (active_sched_policy == SCHED_FAIR)
+    fair_enqueue(t);
   else
     PANIC("Unimplemented scheduling policy value: %d", active_sched_policy);
 }
@@ -247,7 +353,8 @@ static void thread_enqueue(struct thread* t) {
    This function does not preempt the running thread.  This can
    be important: if the caller had disabled interrupts itself,
    it may expect that it can atomically unblock a thread and
-   update other data. */
+   update other data.  Call thread_check_preempt() afterward to
+   let a higher-priority thread run. */
 void thread_unblock(struct thread* t) {
   enum intr_level old_level;
 
@@ -257,9 +364,95 @@ void thread_unblock(struct thread* t) {
   ASSERT(t->status == THREAD_BLOCKED);
   thread_enqueue(t);
   t->status = THREAD_READY;
+  timer_resume_ticks();
   intr_set_level(old_level);
 }
 
+/* Returns true if a ready thread should run in place of the
+   running thread under the active scheduling policy.  The idle
+   thread always gives way to a ready thread.
+
+   This function must be called with interrupts turned off. */
+static bool thread_should_preempt(void) {
+  struct thread* cur = thread_current();
+
+  ASSERT(intr_get_level() == INTR_OFF);
+
+  if (active_sched_policy == SCHED_FIFO)
+    return cur == idle_thread && !list_empty(&fifo_ready_list);
+  else if (active_sched_policy == SCHED_FAIR)
+    return cur == idle_thread && fair_heap_len > 0;
+  else if (prio_scheduled())
+    return prio_highest_ready() > (cur == idle_thread ? -1 : cur->priority);
+  else
+    return false;
+}
+
+/* Yields the CPU if a ready thread should run in place of the
+   running thread, for example because a higher-priority thread
+   was just unblocked.  In an interrupt context, the yield is
+   deferred until the interrupt returns. */
+void thread_check_preempt(void) {
+  enum intr_level old_level = intr_disable();
+
+  if (thread_should_preempt()) {
+    if (intr_context())
+      intr_yield_on_return();
+    else
+      thread_yield();
+  }
+
+  intr_set_level(old_level);
+}
+
+/* Sets T's effective priority to PRIORITY, moving T to the
+   matching ready queue if it is ready.  A thread whose priority
+   does not change keeps its place in its queue.  Does not
+   preempt.
+
+   This function must be called with interrupts turned off. */
+void thread_set_effective_priority(struct thread* t, int priority) {
+  ASSERT(intr_get_level() == INTR_OFF);
+  ASSERT(PRI_MIN <= priority && priority <= PRI_MAX);
+
+  if (t->priority == priority)
+    return;
+
+  if (t->status == THREAD_READY && prio_scheduled()) {
+    prio_dequeue(t);
+    t->priority = priority;
+    prio_enqueue(t);
+  } else
+    t->priority = priority;
+}
+
+/* Recomputes T's effective priority as the highest of its base
+   priority and the priorities donated through the locks it
+   holds.  Waiters are kept in priority order, so each lock
+   contributes the priority of its first waiter and the cost is
+   in the number of locks held, not the number of waiters.
+
+   This function must be called with interrupts turned off. */
+void thread_update_priority(struct thread* t) {
+  int priority = t->base_priority;
+  struct list_elem* e;
+
+  ASSERT(intr_get_level() == INTR_OFF);
+
+  if (active_sched_policy == SCHED_PRIO) {
+    for (e = list_begin(&t->held_locks); e != list_end(&t->held_locks); e = list_next(e)) {
+      struct list* waiters = &list_entry(e, struct lock, elem)->semaphore.waiters;
+      if (!list_empty(waiters)) {
+        struct thread* waiter = list_entry(list_front(waiters), struct thread, elem);
+        if (waiter->priority > priority)
+          priority = waiter->priority;
+      }
+    }
+  }
+
+  thread_set_effective_priority(t, priority);
+}
+
 /* Returns the name of the running thread. */
 const char* thread_name(void) { return thread_current()->name; }
 
@@ -327,32 +520,65 @@ void thread_foreach(thread_action_func* func, void* aux) {
   }
 }
 
-/* Sets the current thread's priority to NEW_PRIORITY. */
-void thread_set_priority(int new_priority) { thread_current()->priority = new_priority; }
+/* Sets the current thread's base priority to NEW_PRIORITY,
+   yielding if it is no longer the highest.  Priority donated to
+   the thread still applies until the locks are released.
+
+   Ignored under the MLFQS scheduler, which sets priorities
+   itself. */
+void thread_set_priority(int new_priority) {
+  struct thread* cur = thread_current();
+  enum intr_level old_level;
+
+  ASSERT(PRI_MIN <= new_priority && new_priority <= PRI_MAX);
+  if (active_sched_policy == SCHED_MLFQS)
+    return;
+
+  old_level = intr_disable();
+  cur->base_priority = new_priority;
+  thread_update_priority(cur);
+  intr_set_level(old_level);
+
+  thread_check_preempt();
+}
 
 /* Returns the current thread's priority. */
 int thread_get_priority(void) { return thread_current()->priority; }
 
-/* Sets the current thread's nice value to NICE. */
-void thread_set_nice(int nice UNUSED) { /* Not yet implemented. */
+/* Sets the current thread's nice value to NICE and recomputes
+   its priority, yielding if it is no longer the highest. */
+void thread_set_nice(int nice) {
+  struct thread* cur = thread_current();
+  enum intr_level old_level;
+
+  ASSERT(NICE_MIN <= nice && nice <= NICE_MAX);
+
+  old_level = intr_disable();
+  cur->nice = nice;
+  if (active_sched_policy == SCHED_MLFQS)
+    cur->priority = mlfqs_priority(cur);
+  intr_set_level(old_level);
+
+  thread_check_preempt();
 }
 
 /* Returns the current thread's nice value. */
-int thread_get_nice(void) {
-  /* Not yet implemented. */
-  return 0;
-}
+int thread_get_nice(void) { return thread_current()->nice; }
 
 /* Returns 100 times the system load average. */
 int thread_get_load_avg(void) {
-  /* Not yet implemented. */
-  return 0;
+  enum intr_level old_level = intr_disable();
+  int load = fix_round(fix_scale(load_avg, 100));
+  intr_set_level(old_level);
+  return load;
 }
 
 /* Returns 100 times the current thread's recent_cpu value. */
 int thread_get_recent_cpu(void) {
-  /* Not yet implemented. */
-  return 0;
+  enum intr_level old_level = intr_disable();
+  int recent_cpu = fix_round(fix_scale(thread_current()->recent_cpu, 100));
+  intr_set_level(old_level);
+  return recent_cpu;
 }
 
 /* Idle thread.  Executes when no other thread is ready to run.
@@ -427,7 +653,18 @@ static void init_thread(struct thread* t, const char* name, int priority) {
   t->status = THREAD_BLOCKED;
   strlcpy(t->name, name, sizeof t->name);
   t->stack = (uint8_t*)t + PGSIZE;
+
+  /* New threads inherit nice and recent_cpu from their parent.
+     The initial thread starts from zero. */
+  if (t != running_thread()) {
+    t->nice = running_thread()->nice;
+    t->recent_cpu = running_thread()->recent_cpu;
+  }
+  if (active_sched_policy == SCHED_MLFQS)
+    priority = mlfqs_priority(t);
   t->priority = priority;
+  t->base_priority = priority;
+  list_init(&t->held_locks);
   t->pcb = NULL;
   t->magic = THREAD_MAGIC;
 
@@ -455,21 +692,170 @@ static struct thread* thread_schedule_fifo(void) {
     return idle_thread;
 }
 
-/* Strict priority scheduler */
+/* Adds T to the back of the ready queue for its priority. */
+static void prio_enqueue(struct thread* t) {
+  list_push_back(&prio_ready_lists[t->priority], &t->elem);
+  prio_ready_bitmap[t->priority / 32] |= 1u << (t->priority % 32);
+}
+
+/* Removes ready thread T from its priority's ready queue. */
+static void prio_dequeue(struct thread* t) {
+  list_remove(&t->elem);
+  if (list_empty(&prio_ready_lists[t->priority]))
+    prio_ready_bitmap[t->priority / 32] &= ~(1u << (t->priority % 32));
+}
+
+/* Returns the highest priority with a ready thread, or -1 if no
+   thread is ready. */
+static int prio_highest_ready(void) {
+  for (int i = PRIO_BITMAP_WORDS - 1; i >= 0; i--)
+    if (prio_ready_bitmap[i] != 0)
+      return i * 32 + 31 - __builtin_clz(prio_ready_bitmap[i]);
+  return -1;
+}
+
+/* Strict priority scheduler.  Threads of equal priority take
+   turns, since a thread that yields goes to the back of its
+   queue. */
 static struct thread* thread_schedule_prio(void) {
-  PANIC("Unimplemented scheduler policy: \"-sched=prio\"");
+  int priority = prio_highest_ready();
+  struct thread* t;
+
+  if (priority < 0)
+    return idle_thread;
+
+  t = list_entry(list_front(&prio_ready_lists[priority]), struct thread, elem);
+  prio_dequeue(t);
+  return t;
 }
 
-/* Fair priority scheduler */
-static struct thread* thread_schedule_fair(void) {
-  PANIC("Unimplemented scheduler policy: \"-sched=fair\"");
+/* Returns true if the active scheduler runs threads from the
+   priority-indexed ready queues. */
+static bool prio_scheduled(void) {
+  return active_sched_policy == SCHED_PRIO || active_sched_policy == SCHED_MLFQS;
+}
+
+/* Returns T's MLFQS priority,
+   PRI_MAX - (recent_cpu / 4) - (nice * 2), clamped to the valid
+   range. */
+static int mlfqs_priority(struct thread* t) {
+  int priority = PRI_MAX - fix_trunc(fix_unscale(t->recent_cpu, 4)) - t->nice * 2;
+
+  if (priority < PRI_MIN)
+    return PRI_MIN;
+  if (priority > PRI_MAX)
+    return PRI_MAX;
+  return priority;
+}
+
+/* Decays T's recent_cpu by the factor AUX,
+   (2 * load_avg) / (2 * load_avg + 1), and adds its nice value. */
+static void mlfqs_update_recent_cpu(struct thread* t, void* aux) {
+  fixed_point_t* decay = aux;
+
+  if (t != idle_thread)
+    t->recent_cpu = fix_add(fix_mul(*decay, t->recent_cpu), fix_int(t->nice));
 }
 
-/* Multi-level feedback queue scheduler */
-static struct thread* thread_schedule_mlfqs(void) {
-  PANIC("Unimplemented scheduler policy: \"-sched=mlfqs\"");
+/* Recomputes T's priority, moving it between ready queues if it
+   is ready. */
+static void mlfqs_update_priority(struct thread* t, void* aux UNUSED) {
+  if (t != idle_thread)
+    thread_set_effective_priority(t, mlfqs_priority(t));
 }
 
+/* MLFQS bookkeeping for a timer tick with CUR running.
+
+   Between the once-a-second passes, the only recent_cpu that
+   changes is the running thread's, and threads leaving the CPU
+   are brought up to date in thread_enqueue(), so the 4-tick
+   priority update only has to recompute CUR.  The per-second
+   pass visits each thread twice. */
+static void mlfqs_tick(struct thread* cur) {
+  int64_t ticks = timer_ticks();
+
+  if (cur != idle_thread)
+    cur->recent_cpu = fix_add(cur->recent_cpu, fix_int(1));
+
+  if (ticks % TIMER_FREQ == 0) {
+    int ready_threads = ready_count + (cur != idle_thread);
+    fixed_point_t twice_load, decay;
+
+    load_avg = fix_add(fix_mul(fix_frac(59, 60), load_avg),
+                       fix_scale(fix_frac(1, 60), ready_threads));
+
+    twice_load = fix_scale(load_avg, 2);
+    decay = fix_div(twice_load, fix_add(twice_load, fix_int(1)));
+    thread_foreach(mlfqs_update_recent_cpu, &decay);
+    thread_foreach(mlfqs_update_priority, NULL);
+  } else if (ticks % MLFQS_PRIORITY_TICKS == 0)
+    mlfqs_update_priority(cur, NULL);
+}
+
+/* Returns the amount T's pass advances per tick: inversely
+   proportional to its weight, which is its priority plus one. */
+static int fair_stride(struct thread* t) { return STRIDE_ONE / (t->priority + 1); }
+
+/* Returns true if heap entry A should be picked before B. */
+static bool fair_before(const struct thread* a, const struct thread* b) {
+  if (a->pass != b->pass)
+    return a->pass < b->pass;
+  return (int)(a->fair_seq - b->fair_seq) < 0;
+}
+
+/* Adds T to the fair scheduler's heap.  A thread that was blocked
+   does not get to catch up on the time it spent asleep: its pass
+   is moved up to the virtual time, like a new thread's. */
+static void fair_enqueue(struct thread* t) {
+  size_t i = fair_heap_len++;
+
+  /* thread_create() keeps the number of threads within bounds. */
+  ASSERT(fair_heap_len <= FAIR_HEAP_SIZE);
+
+  if (t->pass < fair_vtime)
+    t->pass = fair_vtime;
+  t->fair_seq = fair_next_seq++;
+
+  while (i > 0 && fair_before(t, fair_heap[(i - 1) / 2])) {
+    fair_heap[i] = fair_heap[(i - 1) / 2];
+    i = (i - 1) / 2;
+  }
+  fair_heap[i] = t;
+}
+
+/* Fair priority scheduler: stride scheduling, picking the ready
+   thread with the least pass in O(log n). */
+static struct thread* thread_schedule_fair(void) {
+  struct thread *t, *last;
+  size_t i = 0;
+
+  if (fair_heap_len == 0)
+    return idle_thread;
+
+  t = fair_heap[0];
+  last = fair_heap[--fair_heap_len];
+  for (;;) {
+    size_t child = 2 * i + 1;
+    if (child >= fair_heap_len)
+      break;
+    if (child + 1 < fair_heap_len && fair_before(fair_heap[child + 1], fair_heap[child]))
+      child++;
+    if (!fair_before(fair_heap[child], last))
+      break;
+    fair_heap[i] = fair_heap[child];
+    i = child;
+  }
+  fair_heap[i] = last;
+
+  fair_vtime = t->pass;
+  return t;
+}
+
+/* Multi-level feedback queue scheduler.  Priorities are set by
+   mlfqs_tick() instead of by threads, but otherwise threads are
+   picked as by the strict priority scheduler. */
+static struct thread* thread_schedule_mlfqs(void) { return thread_schedule_prio(); }
+
 /* Not an actual scheduling policy — placeholder for empty
  * slots in the scheduler jump table. */
 static struct thread* thread_schedule_reserved(void) {
@@ -482,7 +868,11 @@ static struct thread* thread_schedule_reserved(void) {
    will be in the run queue.)  If the run queue is empty, return
    idle_thread. */
 static struct thread* next_thread_to_run(void) {
-  return (scheduler_jump_table[active_sched_policy])();
+  struct thread* next = (scheduler_jump_table[active_sched_policy])();
+
+  if (next != idle_thread)
+    ready_count--;
+  return next;
 }
 
 /* Completes a thread switch by activating the new thread's page
@@ -25,6 +25,11 @@ typedef int tid_t;
 #define PRI_DEFAULT 31 /* Default priority. */
 #define PRI_MAX 63     /* Highest priority. */
 
+/* Thread nice values, for the MLFQS scheduler. */
+#define NICE_MIN -20   /* Nicest to other threads. */
+#define NICE_DEFAULT 0 /* Default nice value. */
+#define NICE_MAX 20    /* Least nice to other threads. */
+
 /* A kernel thread or user process.
 
    Each thread structure is stored in its own 4 kB page.  The
@@ -77,22 +82,35 @@ typedef int tid_t;
    value, triggering the assertion. */
 /* The `elem' member has a dual purpose.  It can be an element in
    the run queue (thread.c), or it can be an element in a
-   semaphore wait list (synch.c).  It can be used these two ways
-   only because they are mutually exclusive: only a thread in the
-   ready state is on the run queue, whereas only a thread in the
-   blocked state is on a semaphore wait list. */
+   semaphore wait list (synch.c) or the sleep queue (timer.c).
+   It can be used these ways only because they are mutually
+   exclusive: only a thread in the ready state is on the run
+   queue, whereas only a thread in the blocked state is on a
+   semaphore wait list or the sleep queue, and never both. */
 struct thread {
   /* Owned by thread.c. */
   tid_t tid;                 /* Thread identifier. */
   enum thread_status status; /* Thread state. */
   char name[16];             /* Name (for debugging purposes). */
   uint8_t* stack;            /* Saved stack pointer. */
-  int priority;              /* Priority. */
+  int priority;              /* Effective priority, with donations. */
+  int base_priority;         /* Priority before donations. */
   struct list_elem allelem;  /* List element for all threads list. */
+  int nice;                  /* Nice value, for MLFQS. */
+  fixed_point_t recent_cpu;  /* Recent CPU time, for MLFQS. */
+  int64_t pass;              /* Virtual time used, for the fair scheduler. */
+  unsigned fair_seq;         /* Enqueue order, breaks ties in pass. */
 
-  /* Shared between thread.c and synch.c. */
+  /* Shared between thread.c, synch.c and timer.c. */
   struct list_elem elem; /* List element. */
 
+  /* Shared between thread.c and synch.c, for priority donation. */
+  struct list held_locks;    /* Locks held, see struct lock's `elem'. */
+  struct lock* waiting_lock; /* Lock being acquired, or NULL. */
+
+  /* Owned by timer.c. */
+  int64_t wakeup_tick; /* Tick to wake up at while in timer_sleep(). */
+
 #ifdef USERPROG
   /* Owned by process.c. */
   struct process* pcb; /* Process control block if this thread is a userprog */
@@ -129,6 +147,10 @@ tid_t thread_create(const char* name, int priority, thread_func*, void*);
 
 void thread_block(void);
 void thread_unblock(struct thread*);
+void thread_check_preempt(void);
+int thread_ready_count(void);
+void thread_set_effective_priority(struct thread*, int priority);
+void thread_update_priority(struct thread*);
 
 struct thread* thread_current(void);
 tid_t thread_tid(void);